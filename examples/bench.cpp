@@ -0,0 +1,94 @@
+#include <Arduino.h>
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_BusIoCounter.h"
+
+//==========================================================
+// Bus cost of the Stream methods on target, through the
+// internal loopback. One JSON object per line on Serial,
+// same fields as extras/host/bench/bench_stream.cpp
+//==========================================================
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint8_t CS_PIN = 5;
+constexpr uint32_t SPI_FREQ = 4000000;
+constexpr uint32_t UART_BAUD = 115200;
+constexpr size_t PAYLOAD = 1024;
+constexpr size_t CALLS = 1000;
+
+SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+SC16IS7X0_BusIoCounter *counter;
+uint8_t buffer[64];
+
+void report(const char *name, size_t ops, uint32_t elapsed)
+{
+  const SC16IS7X0_BusIoCounter::Stats &s = counter->stats();
+  Serial.printf("{\"bench\":\"%s\",\"bus\":\"spi\",\"bus_hz\":%u,\"baud\":%u,"
+                "\"mode\":\"poll\",\"ops\":%u,\"transactions\":%u,"
+                "\"bytes_out\":%u,\"bytes_in\":%u,\"tx_per_op\":%.3f,"
+                "\"wire_per_op\":%.3f,\"bus_us\":%u,\"elapsed_us\":%u,"
+                "\"ops_per_s\":%.1f}\n",
+                name, (unsigned)SPI_FREQ, (unsigned)UART_BAUD, (unsigned)ops,
+                (unsigned)s.transactions, (unsigned)s.bytesOut,
+                (unsigned)s.bytesIn, (double)s.transactions / ops,
+                (double)(s.bytesOut + s.bytesIn) / ops, (unsigned)s.busyUs,
+                (unsigned)elapsed, elapsed ? ops * 1e6 / elapsed : 0.0);
+}
+
+// Payload written in chunks and read back through the loopback
+void benchLoopback(bool bytes)
+{
+  size_t sent = 0, received = 0;
+  counter->reset();
+  uint32_t start = micros();
+  while (received < PAYLOAD && micros() - start < 1000000) {
+    if (sent < PAYLOAD && sc16is750.availableForWrite() >= 64) {
+      memset(buffer, (uint8_t)sent, sizeof(buffer));
+      sent += sc16is750.write(buffer, sizeof(buffer));
+    }
+    sc16is750.service();
+    if (bytes) {
+      while (sc16is750.available()) {
+        sc16is750.read();
+        received++;
+      }
+    } else {
+      received += sc16is750.readBytes(buffer, sizeof(buffer));
+    }
+  }
+  report(bytes ? "loopback_read_byte" : "loopback_read_buf", PAYLOAD,
+         micros() - start);
+}
+
+void benchCalls(bool gpio)
+{
+  counter->reset();
+  uint32_t start = micros();
+  for (size_t i = 0; i < CALLS; i++) {
+    if (gpio)
+      sc16is750.digitalRead(i & 0x07);
+    else
+      sc16is750.available();
+  }
+  report(gpio ? "digitalRead" : "available_idle", CALLS, micros() - start);
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  delay(100);
+
+  counter = new SC16IS7X0_BusIoCounter(SC16IS7X0_BusIo::buildSPI(CS_PIN, SPI_FREQ));
+  sc16is750.begin(counter);
+  sc16is750.begin_UART(UART_BAUD);
+  sc16is750.enableLoopback();
+}
+
+void loop()
+{
+  benchLoopback(true);
+  benchLoopback(false);
+  benchCalls(false);
+  benchCalls(true);
+
+  delay(5000);
+}
@@ -0,0 +1,369 @@
+/**
+ * @file SC16IS7X0_PtyBridge.cpp
+ * @brief SC16IS7X0 port exposed as a pseudo-terminal, see SC16IS7X0_PtyBridge.h
+ */
+#include "SC16IS7X0_PtyBridge.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "SC16IS7X0_defines.h"
+
+namespace {
+
+struct Speed {
+    speed_t speed;
+    unsigned long baudrate;
+};
+
+const Speed speeds[] = {
+    {B50, 50},           {B75, 75},           {B110, 110},
+    {B134, 134},         {B150, 150},         {B200, 200},
+    {B300, 300},         {B600, 600},         {B1200, 1200},
+    {B1800, 1800},       {B2400, 2400},       {B4800, 4800},
+    {B9600, 9600},       {B19200, 19200},     {B38400, 38400},
+    {B57600, 57600},     {B115200, 115200},   {B230400, 230400},
+    {B460800, 460800},   {B500000, 500000},   {B576000, 576000},
+    {B921600, 921600},   {B1000000, 1000000}, {B1152000, 1152000},
+    {B1500000, 1500000}, {B2000000, 2000000}, {B2500000, 2500000},
+    {B3000000, 3000000}, {B3500000, 3500000}, {B4000000, 4000000},
+};
+
+// termios fields mapped onto the UART
+constexpr tcflag_t CFLAGS = CSTOPB | CRTSCTS;
+constexpr tcflag_t IFLAGS = IXON | IXOFF;
+
+bool sameLine(const struct termios &a, const struct termios &b)
+{
+    return cfgetospeed(&a) == cfgetospeed(&b) &&
+           (a.c_cflag & CFLAGS) == (b.c_cflag & CFLAGS) &&
+           (a.c_iflag & IFLAGS) == (b.c_iflag & IFLAGS) &&
+           a.c_cc[VSTART] == b.c_cc[VSTART] && a.c_cc[VSTOP] == b.c_cc[VSTOP];
+}
+
+} // namespace
+
+SC16IS7X0_PtyBridge::SC16IS7X0_PtyBridge(SC16IS7X0 &uart)
+    : _uart(uart), _master(-1), _slave(-1), _epoll(-1), _link(nullptr),
+      _watched(0), _ptyFull(false), _pwait2(true), _baudrate(0),
+      _config(SERIAL_8N1), _stop(0), _outHead(0), _outLen(0)
+{
+    _slaveName[0] = '\0';
+    memset(&_tio, 0, sizeof(_tio));
+    resetStats();
+}
+
+SC16IS7X0_PtyBridge::~SC16IS7X0_PtyBridge() { close(); }
+
+bool SC16IS7X0_PtyBridge::open(unsigned long baudrate, SerialConfig config,
+                               const char *link)
+{
+    speed_t speed = speedOf(baudrate);
+    if (isOpen() || speed == B0)
+        return false;
+
+    _master = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (_master < 0 || grantpt(_master) < 0 || unlockpt(_master) < 0 ||
+        ptsname_r(_master, _slaveName, sizeof(_slaveName)) != 0 ||
+        fcntl(_master, F_SETFL, O_NONBLOCK) < 0) {
+        close();
+        return false;
+    }
+
+    // Held open, the master never sees a hang-up between two programs
+    _slave = ::open(_slaveName, O_RDWR | O_NOCTTY | O_CLOEXEC);
+    struct termios tio;
+    if (_slave < 0 || tcgetattr(_slave, &tio) < 0) {
+        close();
+        return false;
+    }
+
+    // Raw, no echo nor translation, at the initial speed and stop bits
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, speed);
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_cflag |= CLOCAL | CREAD;
+    if ((config & UART_NB_STOP_BIT_MASK) == UART_NB_STOP_BIT_2)
+        tio.c_cflag |= CSTOPB;
+    if (tcsetattr(_slave, TCSANOW, &tio) < 0) {
+        close();
+        return false;
+    }
+
+    _epoll = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    if (_epoll < 0 || epoll_ctl(_epoll, EPOLL_CTL_ADD, _master, &ev) < 0) {
+        close();
+        return false;
+    }
+    _watched = EPOLLIN;
+
+    if (link) {
+        // Only a previous symlink is replaced
+        struct stat st;
+        if (lstat(link, &st) == 0 && S_ISLNK(st.st_mode))
+            unlink(link);
+        if (symlink(_slaveName, link) < 0) {
+            close();
+            return false;
+        }
+        _link = strdup(link);
+    }
+
+    _baudrate = 0;
+    _config = config;
+    _ptyFull = false;
+    _outHead = _outLen = 0;
+    _stop = 0;
+    apply(tio);
+    if (_baudrate == 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SC16IS7X0_PtyBridge::close(void)
+{
+    if (_link) {
+        unlink(_link);
+        free(_link);
+        _link = nullptr;
+    }
+    if (_epoll >= 0)
+        ::close(_epoll);
+    if (_slave >= 0)
+        ::close(_slave);
+    if (_master >= 0)
+        ::close(_master);
+    _epoll = _slave = _master = -1;
+    _watched = 0;
+    _slaveName[0] = '\0';
+}
+
+bool SC16IS7X0_PtyBridge::step(int32_t timeoutUs)
+{
+    if (!isOpen())
+        return false;
+
+    if (timeoutUs < 0) {
+        int32_t us = (int32_t)(_uart.nextServiceDeadline() - micros());
+        timeoutUs = us > 0 ? us : 0;
+    }
+
+    uint32_t events = 0;
+    int n = wait(timeoutUs, &events);
+    if (n < 0)
+        return errno == EINTR;
+    _stats.wakeups++;
+
+    checkTermios();
+    _uart.service();
+    if (events & EPOLLOUT)
+        _ptyFull = false;
+    if (events & EPOLLIN)
+        fromPty();
+    toPty();
+    watch();
+    return true;
+}
+
+bool SC16IS7X0_PtyBridge::run(void)
+{
+    while (!_stop) {
+        if (!step())
+            return false;
+    }
+    return true;
+}
+
+void SC16IS7X0_PtyBridge::resetStats(void)
+{
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/**
+ * @brief One epoll wait, with a microsecond timeout where the kernel has
+ * epoll_pwait2(), rounded up to the millisecond otherwise
+ *
+ * @return Number of events, -1 on error
+ */
+int SC16IS7X0_PtyBridge::wait(int32_t timeoutUs, uint32_t *events)
+{
+    struct epoll_event ev;
+    int n = -1;
+
+    _stats.syscalls++;
+    if (_pwait2) {
+        struct timespec ts = {timeoutUs / 1000000,
+                              (long)(timeoutUs % 1000000) * 1000};
+        n = epoll_pwait2(_epoll, &ev, 1, &ts, nullptr);
+        if (n < 0 && errno == ENOSYS) {
+            _pwait2 = false;
+            _stats.syscalls++;
+        }
+    }
+    if (!_pwait2)
+        n = epoll_wait(_epoll, &ev, 1, (timeoutUs + 999) / 1000);
+
+    if (n > 0)
+        *events = ev.events;
+    return n;
+}
+
+/**
+ * @brief Watch the master for what the buffers can take: input while the
+ * software TX buffer has room, output while a write() was short
+ */
+void SC16IS7X0_PtyBridge::watch(void)
+{
+    uint32_t wanted = 0;
+    if (_uart.availableForWrite() > 0)
+        wanted |= EPOLLIN;
+    if (_ptyFull)
+        wanted |= EPOLLOUT;
+    if (wanted == _watched)
+        return;
+
+    struct epoll_event ev = {};
+    ev.events = wanted;
+    _stats.syscalls++;
+    if (epoll_ctl(_epoll, EPOLL_CTL_MOD, _master, &ev) == 0)
+        _watched = wanted;
+}
+
+/**
+ * @brief Queue what the PTY has written, as far as the software TX buffer
+ * takes it
+ */
+void SC16IS7X0_PtyBridge::fromPty(void)
+{
+    size_t room = (size_t)_uart.availableForWrite();
+    if (room == 0)
+        return;
+    if (room > sizeof(_in))
+        room = sizeof(_in);
+
+    _stats.syscalls++;
+    ssize_t n = ::read(_master, _in, room);
+    if (n <= 0)
+        return;
+    _uart.write(_in, (size_t)n);
+    _stats.fromPty += (uint64_t)n;
+}
+
+/**
+ * @brief Hand the received characters to the PTY. The UART is only read once
+ * the previous burst has been taken.
+ */
+void SC16IS7X0_PtyBridge::toPty(void)
+{
+    if (_ptyFull)
+        return;
+
+    if (_outHead == _outLen) {
+        _outHead = 0;
+        _outLen = _uart.readBytes(_out, sizeof(_out));
+        if (_outLen == 0)
+            return;
+    }
+
+    _stats.syscalls++;
+    ssize_t n = ::write(_master, _out + _outHead, _outLen - _outHead);
+    if (n > 0) {
+        _outHead += (size_t)n;
+        _stats.toPty += (uint64_t)n;
+    }
+    if (_outHead < _outLen)
+        _ptyFull = true;
+}
+
+/**
+ * @brief Apply the termios of the slave side if they changed. On a PTY master,
+ * tcgetattr() returns those of the slave.
+ */
+void SC16IS7X0_PtyBridge::checkTermios(void)
+{
+    struct termios tio;
+    _stats.syscalls++;
+    if (tcgetattr(_master, &tio) == 0 && !sameLine(tio, _tio))
+        apply(tio);
+}
+
+void SC16IS7X0_PtyBridge::apply(struct termios tio)
+{
+    // The characters written before are sent in the previous format
+    _uart.flush();
+
+    // B0 (hang-up) and the speeds the UART cannot reach keep the current one
+    bool adjusted = false;
+    unsigned long baudrate = baudrateOf(cfgetospeed(&tio));
+    if (baudrate != _baudrate) {
+        if (baudrate && _uart.updateBaudRate(baudrate)) {
+            _baudrate = baudrate;
+        } else {
+            if (baudrate)
+                _stats.rejected++;
+            cfsetspeed(&tio, speedOf(_baudrate));
+            adjusted = true;
+        }
+    }
+    // Word length and parity of open(), the stop bits of the termios
+    int config = _config & ~UART_NB_STOP_BIT_MASK;
+    config |= (tio.c_cflag & CSTOPB) ? UART_NB_STOP_BIT_2 : UART_NB_STOP_BIT_1;
+    _uart.updateConfig((SerialConfig)config);
+
+    if (tio.c_cflag & CRTSCTS) {
+        _uart.enableHardwareCTS();
+        _uart.enableHardwareRTS();
+    } else {
+        _uart.disableHardwareCTS();
+        _uart.disableHardwareRTS();
+    }
+
+    // IXON: a received XOFF halts the transmitter, IXOFF: XOFF is sent when
+    // the input fills up
+    uint8_t mode = 0;
+    if (tio.c_iflag & IXON)
+        mode |= SC16IS7X0_SWFLOW_RX_XON1;
+    if (tio.c_iflag & IXOFF)
+        mode |= SC16IS7X0_SWFLOW_TX_XON1;
+    if (mode) {
+        _uart.setXonXoff(tio.c_cc[VSTART], tio.c_cc[VSTOP]);
+        _uart.enableSoftwareFlowControl(mode);
+    } else {
+        _uart.disableSoftwareFlowControl();
+    }
+
+    // Like a serial driver, report what the UART actually does
+    if (adjusted) {
+        _stats.syscalls++;
+        tcsetattr(_master, TCSANOW, &tio);
+    }
+
+    _tio = tio;
+    _stats.reconfigs++;
+}
+
+speed_t SC16IS7X0_PtyBridge::speedOf(unsigned long baudrate)
+{
+    for (const Speed &s : speeds) {
+        if (s.baudrate == baudrate)
+            return s.speed;
+    }
+    return B0;
+}
+
+unsigned long SC16IS7X0_PtyBridge::baudrateOf(speed_t speed)
+{
+    for (const Speed &s : speeds) {
+        if (s.speed == speed)
+            return s.baudrate;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file SC16IS7X0_PtyBridge.h
+ * @brief SC16IS7X0 port exposed as a Linux pseudo-terminal
+ * @details The bridge creates a PTY and moves data between its master side
+ * and an SC16IS7X0, on any SC16IS7X0_BusIo (the simulated device included).
+ * Terminal programs and serial libraries (minicom, pyserial, ...) open the
+ * slave side (slaveName(), or a symlink to it) like any serial device.
+ *
+ * One epoll loop serves both directions, in bursts:
+ * - PTY to UART: the master is only watched while the software TX buffer has
+ *   room, and read up to that room with one read(), queued with one write()
+ * - UART to PTY: the software RX buffer is copied out with one write() per
+ *   wake-up. While the PTY does not take more, the UART is not read and the
+ *   RX FIFO fills up (hardware or software flow control holds the remote)
+ * - The wait ends at SC16IS7X0::nextServiceDeadline(), so the FIFOs are
+ *   visited once per FIFO worth of character times, with no timer to read
+ *
+ * The termios of the slave side are checked at every wake-up. A change of
+ * speed, stop bits (CSTOPB), CRTSCTS or IXON / IXOFF is applied to the UART
+ * once the characters already written have been sent: updateBaudRate(),
+ * updateConfig(), hardware and software flow control. Like a serial driver,
+ * a speed rejected by updateBaudRate() is written back to the termios as the
+ * current one. Word length and parity are those given to open(): the Linux
+ * PTY driver forces CS8 and clears PARENB on every tcsetattr(), they never
+ * reach the master.
+ *
+ * The bridge keeps the slave side open, so that programs may open and close
+ * it at will, and sets it to raw mode at the speed and format given to open().
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include <signal.h>
+#include <termios.h>
+
+#include "SC16IS7X0.h"
+
+// Largest burst moved in one read() / write() of the PTY
+#ifndef SC16IS7X0_PTY_BUFFER_SIZE
+#define SC16IS7X0_PTY_BUFFER_SIZE 4096
+#endif
+
+class SC16IS7X0_PtyBridge
+{
+public:
+  struct Stats {
+    uint64_t toPty;     // Characters received by the UART, written to the PTY
+    uint64_t fromPty;   // Characters read from the PTY, queued for the UART
+    uint32_t wakeups;   // Waits returned, on an event or at the deadline
+    uint32_t syscalls;  // epoll, read, write and termios calls of the bridge
+    uint32_t reconfigs; // termios changes applied to the UART
+    uint32_t rejected;  // Speeds the UART could not reach, left unchanged
+  };
+
+  /**
+   * @param uart Port, begin_UART() already called
+   */
+  SC16IS7X0_PtyBridge(SC16IS7X0 &uart);
+  ~SC16IS7X0_PtyBridge();
+
+  /**
+   * @brief Create the PTY and apply its termios to the UART
+   *
+   * @param baudrate Initial speed of the slave side, one of the Bxxx speeds
+   * @param config Format of the UART, the stop bits may then be changed
+   * through the termios
+   * @param link Path of a symlink to the slave side, nullptr for none
+   * @return false if the PTY could not be created or the UART cannot reach
+   * the speed
+   */
+  bool open(unsigned long baudrate = 115200, SerialConfig config = SERIAL_8N1,
+            const char *link = nullptr);
+
+  /**
+   * @brief Close the PTY and remove the symlink
+   */
+  void close(void);
+
+  bool isOpen(void) const { return _master >= 0; }
+
+  /**
+   * @brief Path of the slave side, e.g. /dev/pts/3
+   */
+  const char *slaveName(void) const { return _slaveName; }
+
+  /**
+   * @brief epoll descriptor of the bridge, readable when the PTY has work.
+   * An outer event loop nesting the bridge calls step(0) when it is readable
+   * or when SC16IS7X0::nextServiceDeadline() is reached.
+   */
+  int fd(void) const { return _epoll; }
+
+  /**
+   * @brief Wait for the PTY or the UART service deadline, then move data
+   *
+   * @param timeoutUs Longest wait, -1 for nextServiceDeadline(). With the
+   * virtual clock, 0: the caller advances time.
+   * @return false on error
+   */
+  bool step(int32_t timeoutUs = -1);
+
+  /**
+   * @brief step() until stop() or an error
+   */
+  bool run(void);
+
+  /**
+   * @brief Make run() return, callable from a signal handler
+   */
+  void stop(void) { _stop = 1; }
+
+  const Stats &stats(void) const { return _stats; }
+  void resetStats(void);
+
+private:
+  int wait(int32_t timeoutUs, uint32_t *events);
+  void watch(void);
+  void fromPty(void);
+  void toPty(void);
+  void checkTermios(void);
+  void apply(struct termios tio);
+
+  static speed_t speedOf(unsigned long baudrate);
+  static unsigned long baudrateOf(speed_t speed);
+
+  SC16IS7X0 &_uart;
+  int _master;
+  int _slave;
+  int _epoll;
+  char _slaveName[64];
+  char *_link;
+  uint32_t _watched; // epoll events of the master
+  bool _ptyFull;     // Last write() to the master was short
+  bool _pwait2;      // epoll_pwait2() has not failed with ENOSYS
+  struct termios _tio; // Last termios applied to the UART
+  unsigned long _baudrate;
+  SerialConfig _config;
+  volatile sig_atomic_t _stop;
+  size_t _outHead;
+  size_t _outLen;
+  uint8_t _out[SC16IS7X0_PTY_BUFFER_SIZE]; // UART to PTY
+  uint8_t _in[SC16IS7X0_PTY_BUFFER_SIZE];  // PTY to UART
+  Stats _stats;
+};
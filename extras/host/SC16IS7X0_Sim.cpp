@@ -0,0 +1,873 @@
+/**
+ * @file SC16IS7X0_Sim.cpp
+ * @brief Simulated SC16IS7X0, see SC16IS7X0_Sim.h
+ */
+#include "SC16IS7X0_Sim.h"
+
+#include <algorithm>
+
+#include "SC16IS7X0_defines.h"
+
+SC16IS7X0_Sim::SC16IS7X0_Sim(uint32_t xtalFreq, ioBus bus, uint32_t busFreq)
+    : _xtalFreq(xtalFreq), _bus(bus), _busFreq(busFreq),
+      _maxTransfer(bus == I2C_BUS ? 32 : 0), _irqPin(-1), _async(false),
+      _dma(false), _queueDepth(0), _dmaEndNs(0), _irqAsserted(false), _nowNs(0),
+      _busTimeNs(0), _overruns(0), _rtsSkid(0), _accessNs(0),
+      _inputPatternStartNs(0), _inputPatternNs(0), _traceIo(false)
+{
+    assert(xtalFreq > 0 && busFreq > 0);
+    _nowNs = HostArduino::nowMicros() * 1000;
+    reset();
+    HostArduino::onTick(tick, this);
+}
+
+SC16IS7X0_Sim::~SC16IS7X0_Sim()
+{
+    HostArduino::removeTick(tick, this);
+    if (_irqPin >= 0 && _irqAsserted)
+        HostArduino::pullPinLow((uint8_t)_irqPin, false);
+}
+
+void SC16IS7X0_Sim::reset(void)
+{
+    _ier = 0x00;
+    _fcr = 0x00;
+    _lcr = 0x1D;
+    _mcr = 0x00;
+    _spr = 0xFF;
+    _tcr = 0x00;
+    _tlr = 0x00;
+    // Undefined on POR, keep a usable value
+    _dll = 0x01;
+    _dlh = 0x00;
+    _efr = 0x00;
+    _xon1 = _xon2 = _xoff1 = _xoff2 = 0x00;
+    _ioDir = 0x00;
+    _ioState = 0x00;
+    _ioIntEna = 0x00;
+    _ioControl = 0x00;
+    _efcr = 0x00;
+    _ioInputs = 0x00;
+    _ioLatched = 0x00;
+    _ioChanged = false;
+
+    _rxFifo.clear();
+    _txFifo.clear();
+
+    _overrun = false;
+    _thrLatched = false;
+    _thrPrevious = false;
+    _ctsActive = true;
+    _rtsActive = false;
+    _skidLeft = 0;
+    _txControl.clear();
+    _xoffSent = false;
+    _txHeld = false;
+    _remoteHeld = false;
+    _xoffLatched = false;
+    _txShiftControl = false;
+    _addressed = false;
+    _txBusy = false;
+    _txShift = 0;
+    _txEndNs = 0;
+    _rxNextNs = _nowNs;
+    _rxLastNs = _nowNs;
+    updateIrq();
+}
+
+void SC16IS7X0_Sim::setBus(ioBus bus, uint32_t busFreq)
+{
+    assert(busFreq > 0);
+    _bus = bus;
+    _busFreq = busFreq;
+}
+
+void SC16IS7X0_Sim::attachIrqPin(uint8_t pin)
+{
+    if (_irqPin >= 0 && _irqAsserted)
+        HostArduino::pullPinLow((uint8_t)_irqPin, false);
+    _irqPin = pin;
+    _irqAsserted = false;
+    updateIrq();
+}
+
+//==========================================================
+// Bus interface
+//==========================================================
+
+bool SC16IS7X0_Sim::read(uint8_t *buffer, size_t len)
+{
+    drain();
+
+    // The device always needs a subaddress first
+    (void)buffer;
+    (void)len;
+    return false;
+}
+
+bool SC16IS7X0_Sim::write(const uint8_t *buffer, size_t len,
+                          const uint8_t *prefix_buffer, size_t prefix_len)
+{
+    drain();
+    if (_maxTransfer && prefix_len + len > _maxTransfer)
+        return false;
+    if (prefix_len + len == 0)
+        return false;
+
+    update();
+
+    uint8_t subaddress = prefix_len ? prefix_buffer[0] : buffer[0];
+    uint8_t reg = (subaddress >> 3) & 0x0F;
+
+    // Every data byte goes to the same register (no auto-increment)
+    uint64_t startNs = _nowNs;
+    size_t bytes = 1;
+    for (size_t i = 1; i < prefix_len; i++) {
+        _accessNs = startNs + busTimeNs(++bytes, false);
+        writeReg(reg, prefix_buffer[i]);
+    }
+    for (size_t i = prefix_len ? 0 : 1; i < len; i++) {
+        _accessNs = startNs + busTimeNs(++bytes, false);
+        writeReg(reg, buffer[i]);
+    }
+
+    updateIrq();
+    spendBusTime(prefix_len + len, false);
+    return true;
+}
+
+bool SC16IS7X0_Sim::write_then_read(const uint8_t *write_buffer,
+                                    size_t write_len, uint8_t *read_buffer,
+                                    size_t read_len)
+{
+    drain();
+    if (_maxTransfer && write_len > _maxTransfer)
+        return false;
+    if (write_len == 0)
+        return false;
+
+    update();
+
+    uint8_t reg = (write_buffer[0] >> 3) & 0x0F;
+    uint64_t startNs = _nowNs;
+    for (size_t i = 1; i < write_len; i++) {
+        _accessNs = startNs + busTimeNs(i + 1, false);
+        writeReg(reg, write_buffer[i]);
+    }
+    for (size_t i = 0; i < read_len; i++) {
+        _accessNs = startNs + busTimeNs(write_len + i + 1, true);
+        read_buffer[i] = readReg(reg);
+    }
+
+    updateIrq();
+    spendBusTime(write_len + read_len, true);
+    return true;
+}
+
+size_t SC16IS7X0_Sim::maxTransferSize(void)
+{
+    return _maxTransfer ? _maxTransfer : SIZE_MAX;
+}
+
+bool SC16IS7X0_Sim::submit(Transaction *t)
+{
+    if (!_async)
+        return SC16IS7X0_BusIo::submit(t);
+    if (_queueDepth && _submitted.size() >= _queueDepth)
+        return false;
+
+    // Transferred back-to-back after the transactions already queued
+    uint64_t nowNs = HostArduino::nowMicros() * 1000;
+    uint64_t startNs = _dmaEndNs > nowNs ? _dmaEndNs : nowNs;
+    _dmaEndNs = startNs + busTimeNs(t->tx_len + t->rx_len, t->rx_len > 0);
+    _submitted.push_back({t, _dmaEndNs});
+    return true;
+}
+
+size_t SC16IS7X0_Sim::poll(void)
+{
+    if (!_async)
+        return SC16IS7X0_BusIo::poll();
+    if (draining)
+        return 0;
+
+    draining = true;
+    size_t count = 0;
+    while (complete(HostArduino::nowMicros() * 1000))
+        count++;
+    draining = false;
+    return count;
+}
+
+void SC16IS7X0_Sim::drain(void)
+{
+    if (!_async) {
+        SC16IS7X0_BusIo::drain();
+        return;
+    }
+    if (draining)
+        return;
+
+    // The CPU waits for the end of the queued transfers
+    draining = true;
+    while (!_submitted.empty()) {
+        uint64_t nowUs = HostArduino::nowMicros();
+        uint64_t endUs = (_submitted.front().endNs + 999) / 1000;
+        if (endUs > nowUs)
+            HostArduino::advanceMicros(endUs - nowUs);
+        complete(endUs * 1000);
+    }
+    draining = false;
+}
+
+bool SC16IS7X0_Sim::complete(uint64_t nowNs)
+{
+    if (_submitted.empty() || _submitted.front().endNs > nowNs)
+        return false;
+
+    Transaction *t = _submitted.front().t;
+    _submitted.pop_front();
+
+    // Bus time is not charged to the CPU
+    _dma = true;
+    execute(t);
+    _dma = false;
+    return true;
+}
+
+uint64_t SC16IS7X0_Sim::busTimeNs(size_t bytes, bool repeatedStart) const
+{
+    uint64_t bits;
+    if (_bus == SPI_BUS) {
+        // 8 clocks per byte, plus chip select setup and hold
+        bits = bytes * 8 + 2;
+    } else {
+        // START, address + ACK, 9 clocks per byte, STOP
+        bits = 1 + 9 + bytes * 9 + 1;
+        if (repeatedStart)
+            bits += 1 + 9;
+        // Reads longer than the buffer are split by the I2C layer
+        if (_maxTransfer && bytes > _maxTransfer)
+            bits += ((bytes - 1) / _maxTransfer) * (1 + 9 + 1);
+    }
+
+    return bits * 1000000000ULL / _busFreq;
+}
+
+void SC16IS7X0_Sim::spendBusTime(size_t bytes, bool repeatedStart)
+{
+    uint64_t ns = busTimeNs(bytes, repeatedStart);
+    if (_dma) {
+        _busTimeNs += ns;
+        return;
+    }
+
+    uint64_t before = _busTimeNs / 1000;
+    _busTimeNs += ns;
+    HostArduino::advanceMicros(_busTimeNs / 1000 - before);
+}
+
+//==========================================================
+// Register file
+//==========================================================
+
+uint8_t SC16IS7X0_Sim::readReg(uint8_t reg)
+{
+    switch (reg) {
+    case SC16IS7X0_RHR:
+        if (special())
+            return _dll;
+        if (_rxFifo.empty())
+            return 0x00;
+        {
+            uint8_t c = _rxFifo.front().data;
+            _rxFifo.pop_front();
+            _rxLastNs = _nowNs;
+            receive(-1);
+            return c;
+        }
+
+    case SC16IS7X0_IER:
+        return special() ? _dlh : _ier;
+
+    case SC16IS7X0_IIR:
+        return enhanced() ? _efr : iir();
+
+    case SC16IS7X0_LCR:
+        return _lcr;
+
+    case SC16IS7X0_MCR:
+        return enhanced() ? _xon1 : _mcr;
+
+    case SC16IS7X0_LSR:
+        if (enhanced())
+            return _xon2;
+        {
+            uint8_t val = lsr();
+            _overrun = false;
+            return val;
+        }
+
+    case SC16IS7X0_MSR:
+        if (enhanced())
+            return _xoff1;
+        if (tcrTlr())
+            return _tcr;
+        return _ctsActive ? 0x10 : 0x00;
+
+    case SC16IS7X0_SPR:
+        if (enhanced())
+            return _xoff2;
+        return tcrTlr() ? _tlr : _spr;
+
+    case SC16IS7X0_TXLVL:
+        return txlvl();
+
+    case SC16IS7X0_RXLVL:
+        return rxlvl();
+
+    case SC16IS7X0_IODIR:
+        return _ioDir;
+
+    case SC16IS7X0_IOSTATE:
+        _ioChanged = false;
+        if (_ioControl & 0x01)
+            return (_ioState & _ioDir) | (_ioLatched & ~_ioDir);
+        return (_ioState & _ioDir) | (inputPins() & ~_ioDir);
+
+    case SC16IS7X0_IOINTENA:
+        return _ioIntEna;
+
+    case SC16IS7X0_IOCONTROL:
+        return _ioControl & ~0x08;
+
+    case SC16IS7X0_EFCR:
+        return _efcr;
+
+    default:
+        return 0x00;
+    }
+}
+
+void SC16IS7X0_Sim::writeReg(uint8_t reg, uint8_t val)
+{
+    switch (reg) {
+    case SC16IS7X0_THR:
+        if (special()) {
+            _dll = val;
+        } else {
+            // Characters are lost when the TX FIFO overflows
+            if (_txFifo.size() < FIFO)
+                _txFifo.push_back(val);
+            _thrLatched = false;
+            _thrPrevious = thrCondition();
+        }
+        break;
+
+    case SC16IS7X0_IER:
+        if (special()) {
+            _dlh = val;
+        } else {
+            // IER[7:4] are only writable when EFR[4] is set
+            if (!(_efr & 0x10))
+                val = (val & 0x0F) | (_ier & 0xF0);
+            if ((val & 0x02) && !(_ier & 0x02) && thrCondition())
+                _thrLatched = true;
+            _ier = val;
+        }
+        break;
+
+    case SC16IS7X0_FCR:
+        if (enhanced()) {
+            _efr = val;
+        } else {
+            if (val & 0x02)
+                _rxFifo.clear();
+            if (val & 0x04)
+                _txFifo.clear();
+            // FCR[5:4] are only writable when EFR[4] is set
+            if (!(_efr & 0x10))
+                val = (val & ~0x30) | (_fcr & 0x30);
+            _fcr = val & ~0x06;
+        }
+        break;
+
+    case SC16IS7X0_LCR:
+        _lcr = val;
+        break;
+
+    case SC16IS7X0_MCR:
+        if (enhanced()) {
+            _xon1 = val;
+        } else {
+            // MCR[7:5] are only writable when EFR[4] is set
+            if (!(_efr & 0x10))
+                val = (val & 0x1F) | (_mcr & 0xE0);
+            _mcr = val;
+            if (!(_efr & 0x40))
+                _rtsActive = (_mcr & 0x02) != 0;
+        }
+        break;
+
+    case SC16IS7X0_LSR:
+        if (enhanced())
+            _xon2 = val;
+        break;
+
+    case SC16IS7X0_TCR:
+        if (enhanced())
+            _xoff1 = val;
+        else if (tcrTlr())
+            _tcr = val;
+        break;
+
+    case SC16IS7X0_SPR:
+        if (enhanced())
+            _xoff2 = val;
+        else if (tcrTlr())
+            _tlr = val;
+        else
+            _spr = val;
+        break;
+
+    case SC16IS7X0_IODIR:
+        _ioDir = val;
+        break;
+
+    case SC16IS7X0_IOSTATE:
+        _ioState = val;
+        if (_traceIo)
+            _ioTrace.push_back({_accessNs, outputPins()});
+        break;
+
+    case SC16IS7X0_IOINTENA:
+        _ioIntEna = val;
+        break;
+
+    case SC16IS7X0_IOCONTROL:
+        if (val & 0x08) {
+            reset();
+            return;
+        }
+        if ((val & 0x01) && !(_ioControl & 0x01))
+            _ioLatched = inputPins();
+        _ioControl = val;
+        break;
+
+    case SC16IS7X0_EFCR:
+        _efcr = val;
+        break;
+
+    default:
+        break;
+    }
+}
+
+uint8_t SC16IS7X0_Sim::lsr(void)
+{
+    uint8_t val = 0x00;
+    if (!_rxFifo.empty())
+        val |= 0x01 | _rxFifo.front().error;
+    if (_overrun)
+        val |= 0x02;
+    if (_txFifo.empty()) {
+        val |= 0x20;
+        if (!_txBusy)
+            val |= 0x40;
+    }
+    for (const RxChar &c : _rxFifo) {
+        if (c.error) {
+            val |= 0x80;
+            break;
+        }
+    }
+    return val;
+}
+
+uint8_t SC16IS7X0_Sim::iir(void)
+{
+    uint8_t fifo = (_fcr & 0x01) ? 0xC0 : 0x00;
+    uint8_t source = SC16IS7X0_IIR_NONE;
+
+    bool lineError = _overrun || (!_rxFifo.empty() && _rxFifo.front().error);
+    bool timeout = !_rxFifo.empty() && _rxFifo.size() < rxTrigger() &&
+                   _nowNs - _rxLastNs >= 4ULL * charTimeNs();
+
+    if ((_ier & 0x04) && lineError)
+        source = SC16IS7X0_IIR_RLS;
+    else if ((_ier & 0x01) && timeout)
+        source = SC16IS7X0_IIR_RX_TIMEOUT;
+    else if ((_ier & 0x01) && _rxFifo.size() >= rxTrigger())
+        source = SC16IS7X0_IIR_RHR;
+    else if ((_ier & 0x02) && _thrLatched) {
+        source = SC16IS7X0_IIR_THR;
+        // Cleared by reading IIR
+        _thrLatched = false;
+    } else if (_ioIntEna && _ioChanged)
+        source = SC16IS7X0_IIR_IO;
+    else if ((_ier & 0x20) && _xoffLatched) {
+        source = SC16IS7X0_IIR_XOFF;
+        // Cleared by reading IIR
+        _xoffLatched = false;
+    }
+
+    return fifo | source;
+}
+
+void SC16IS7X0_Sim::updateIrq(void)
+{
+    if (_irqPin < 0)
+        return;
+
+    // Evaluate without side effect on the THR and XOFF latches
+    bool thr = _thrLatched;
+    bool xoff = _xoffLatched;
+    bool pending = !(iir() & SC16IS7X0_IIR_NONE);
+    _thrLatched = thr;
+    _xoffLatched = xoff;
+
+    // Open-drain output, several devices may share the line
+    if (pending != _irqAsserted) {
+        _irqAsserted = pending;
+        HostArduino::pullPinLow((uint8_t)_irqPin, pending);
+    }
+}
+
+uint8_t SC16IS7X0_Sim::rxTrigger(void) const
+{
+    static const uint8_t fcrLevels[4] = {8, 16, 56, 60};
+    if (tcrTlr() && (_tlr >> 4))
+        return (_tlr >> 4) * 4;
+    return fcrLevels[_fcr >> 6];
+}
+
+uint8_t SC16IS7X0_Sim::txTrigger(void) const
+{
+    static const uint8_t fcrLevels[4] = {8, 16, 32, 56};
+    if (tcrTlr() && (_tlr & 0x0F))
+        return (_tlr & 0x0F) * 4;
+    return fcrLevels[(_fcr >> 4) & 0x03];
+}
+
+bool SC16IS7X0_Sim::thrCondition(void) const
+{
+    return (FIFO - _txFifo.size()) >= txTrigger();
+}
+
+//==========================================================
+// UART
+//==========================================================
+
+double SC16IS7X0_Sim::baudrate(void) const
+{
+    uint32_t divisor = ((uint32_t)_dlh << 8) | _dll;
+    if (divisor == 0)
+        return 0.0;
+    double clock = (_mcr & 0x80) ? _xtalFreq / 4.0 : (double)_xtalFreq;
+    return clock / (16.0 * divisor);
+}
+
+uint32_t SC16IS7X0_Sim::charTimeNs(void) const
+{
+    double baud = baudrate();
+    if (baud <= 0.0)
+        return UINT32_MAX;
+
+    // Start bit + data + parity + stop, counted in half bits
+    uint32_t halfBits = 2 + 2 * (5 + (_lcr & 0x03));
+    if (_lcr & 0x08)
+        halfBits += 2;
+    if (_lcr & 0x04)
+        halfBits += (_lcr & 0x03) == 0 ? 3 : 4;
+    else
+        halfBits += 2;
+
+    return (uint32_t)(halfBits * 500000000.0 / baud);
+}
+
+void SC16IS7X0_Sim::inject(const uint8_t *data, size_t len)
+{
+    update();
+    if (_incoming.empty() && _rxNextNs < _nowNs + charTimeNs())
+        _rxNextNs = _nowNs + charTimeNs();
+    _incoming.insert(_incoming.end(), data, data + len);
+}
+
+void SC16IS7X0_Sim::injectAddress(uint8_t address)
+{
+    update();
+    if (_incoming.empty() && _rxNextNs < _nowNs + charTimeNs())
+        _rxNextNs = _nowNs + charTimeNs();
+    _incoming.push_back(0x100 | address);
+}
+
+std::vector<uint8_t> SC16IS7X0_Sim::takeTransmitted(void)
+{
+    std::vector<uint16_t> frames = takeTransmitted9();
+    return std::vector<uint8_t>(frames.begin(), frames.end());
+}
+
+std::vector<uint16_t> SC16IS7X0_Sim::takeTransmitted9(void)
+{
+    update();
+    std::vector<uint16_t> out;
+    out.swap(_transmitted);
+    return out;
+}
+
+bool SC16IS7X0_Sim::rtsHigh(void) const
+{
+    if (!(_efcr & 0x10))
+        return !_rtsActive;
+
+    // EFCR[5] = 0: low while transmitting, high otherwise
+    bool transmitting = _txBusy || !_txFifo.empty() || !_txControl.empty();
+    return (_efcr & 0x20) ? transmitting : !transmitting;
+}
+
+bool SC16IS7X0_Sim::txParityBit(uint8_t c) const
+{
+    // LCR[5:3] = 001 odd, 011 even, 101 forced to 1, 111 forced to 0
+    switch (_lcr & 0x38) {
+    case 0x08:
+    case 0x18: {
+        int ones = __builtin_popcount(c & (0xFF >> (3 - (_lcr & 0x03))));
+        return (ones & 1) == ((_lcr & 0x10) ? 1 : 0);
+    }
+    case 0x28:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void SC16IS7X0_Sim::setInputPattern(const std::vector<uint8_t> &levels,
+                                    uint32_t periodNs)
+{
+    update();
+    _inputPattern = levels;
+    _inputPatternStartNs = _nowNs;
+    _inputPatternNs = periodNs;
+}
+
+std::vector<SC16IS7X0_Sim::PinSample> SC16IS7X0_Sim::takeOutputTrace(void)
+{
+    std::vector<PinSample> trace;
+    trace.swap(_ioTrace);
+    return trace;
+}
+
+void SC16IS7X0_Sim::setInputPins(uint8_t levels)
+{
+    update();
+    _inputPattern.clear();
+    uint8_t changed = (levels ^ _ioInputs) & ~_ioDir & _ioIntEna;
+    _ioInputs = levels;
+    if (changed)
+        _ioChanged = true;
+    updateIrq();
+}
+
+uint8_t SC16IS7X0_Sim::inputPins(void) const
+{
+    if (!_inputPattern.empty() && _inputPatternNs) {
+        uint64_t i = _accessNs > _inputPatternStartNs
+                         ? (_accessNs - _inputPatternStartNs) / _inputPatternNs
+                         : 0;
+        if (i >= _inputPattern.size())
+            i = _inputPattern.size() - 1;
+        return _inputPattern[i];
+    }
+    return _ioInputs;
+}
+
+void SC16IS7X0_Sim::receive(int c)
+{
+    if (c >= 0 && receiveMultidrop(c) &&
+        ((c & 0x100) || !receiveControl((uint8_t)c))) {
+        // Special character detect, outside of the 9-bit mode
+        if ((_efr & 0x20) && !(_efcr & 0x01) && (uint8_t)c == _xoff2)
+            _xoffLatched = true;
+        _rxLastNs = _nowNs;
+        if (_rxFifo.size() >= FIFO) {
+            _overrun = true;
+            _overruns++;
+        } else {
+            // In 9-bit mode the parity error bit flags addresses
+            uint8_t error = (_efcr & 0x01) && (c & 0x100) ? 0x04 : 0x00;
+            _rxFifo.push_back({(uint8_t)c, error});
+        }
+    }
+
+    updateFlowControl();
+}
+
+bool SC16IS7X0_Sim::receiveMultidrop(int c)
+{
+    bool address = (c & 0x100) != 0;
+    if (!(_efcr & 0x01) || !(_efr & 0x20))
+        return !(_efcr & 0x02);
+
+    // Address detection: only the frames following XOFF2 are received
+    if (address)
+        _addressed = (uint8_t)c == _xoff2;
+    return _addressed;
+}
+
+bool SC16IS7X0_Sim::receiveControl(uint8_t c)
+{
+    // EFR[1] compares XON1 / XOFF1, EFR[0] XON2 / XOFF2, they are not stored
+    bool one = (_efr & 0x02) != 0;
+    bool two = (_efr & 0x01) != 0;
+    if ((one && c == _xoff1) || (two && c == _xoff2)) {
+        _txHeld = true;
+        _xoffLatched = true;
+        return true;
+    }
+    if ((one && c == _xon1) || (two && c == _xon2)) {
+        _txHeld = false;
+        return true;
+    }
+
+    // Xon Any
+    if (_mcr & 0x20)
+        _txHeld = false;
+    return false;
+}
+
+void SC16IS7X0_Sim::sendControl(bool xon)
+{
+    // EFR[3] sends XON1 / XOFF1, EFR[2] XON2 / XOFF2, in this order
+    if (_efr & 0x08)
+        _txControl.push_back(xon ? _xon1 : _xoff1);
+    if (_efr & 0x04)
+        _txControl.push_back(xon ? _xon2 : _xoff2);
+}
+
+void SC16IS7X0_Sim::updateFlowControl(void)
+{
+    size_t halt = (size_t)(_tcr & 0x0F) * 4;
+    size_t resume = (size_t)(_tcr >> 4) * 4;
+
+    // Automatic RTS, TCR[3:0] halt and TCR[7:4] resume levels
+    if (_efr & 0x40) {
+        if (_rxFifo.size() >= halt) {
+            if (_rtsActive)
+                _skidLeft = _rtsSkid;
+            _rtsActive = false;
+        } else if (_rxFifo.size() <= resume) {
+            _rtsActive = true;
+        }
+    }
+
+    // Automatic XOFF / XON on the same levels
+    if (_efr & 0x0C) {
+        if (!_xoffSent && _rxFifo.size() >= halt) {
+            sendControl(false);
+            _xoffSent = true;
+        } else if (_xoffSent && _rxFifo.size() <= resume) {
+            sendControl(true);
+            _xoffSent = false;
+        }
+    } else {
+        _xoffSent = false;
+    }
+}
+
+bool SC16IS7X0_Sim::remoteHalted(void) const
+{
+    return ((_efr & 0x40) && !_rtsActive) || _remoteHeld;
+}
+
+void SC16IS7X0_Sim::update(void)
+{
+    advanceTo(HostArduino::nowMicros() * 1000);
+}
+
+void SC16IS7X0_Sim::tick(void *arg, uint64_t nowUs)
+{
+    SC16IS7X0_Sim *sim = static_cast<SC16IS7X0_Sim *>(arg);
+    sim->advanceTo(nowUs * 1000);
+}
+
+void SC16IS7X0_Sim::advanceTo(uint64_t nowNs)
+{
+    if (nowNs < _nowNs)
+        nowNs = _nowNs;
+
+    uint64_t ct = charTimeNs();
+    bool loopback = (_mcr & 0x10) != 0;
+
+    for (;;) {
+        updateFlowControl();
+
+        // The transmitter picks the next character as soon as it is idle,
+        // XON / XOFF first and whatever the flow control. In loopback, RTS
+        // drives CTS.
+        bool cts = loopback ? _rtsActive : _ctsActive;
+        bool held = ((_efr & 0x80) && !cts) ||
+                    ((_efr & 0x03) && _txHeld);
+        if (!_txBusy && ct != UINT32_MAX &&
+            (!_txControl.empty() || (!_txFifo.empty() && !held))) {
+            _txBusy = true;
+            _txShiftControl = !_txControl.empty();
+            std::deque<uint8_t> &from = _txShiftControl ? _txControl : _txFifo;
+            _txShift = from.front();
+            from.pop_front();
+            if (txParityBit((uint8_t)_txShift))
+                _txShift |= 0x100;
+            _txEndNs = _nowNs + ct;
+        }
+
+        bool remote = !_incoming.empty() && !loopback && ct != UINT32_MAX &&
+                      (!remoteHalted() || _skidLeft);
+
+        uint64_t next = UINT64_MAX;
+        if (_txBusy)
+            next = _txEndNs;
+        if (remote && _rxNextNs < next)
+            next = std::max(_rxNextNs, _nowNs);
+        if (next > nowNs)
+            break;
+
+        _nowNs = next;
+        if (_txBusy && _txEndNs == next) {
+            _txBusy = false;
+            if (loopback) {
+                receive(_txShift);
+            } else {
+                _transmitted.push_back(_txShift);
+                // The remote reacts once the XOFF / XON is complete
+                if (_txShiftControl && _txControl.empty()) {
+                    if (!_remoteHeld && _xoffSent)
+                        _skidLeft = _rtsSkid;
+                    _remoteHeld = _xoffSent;
+                }
+            }
+        } else {
+            if (remoteHalted() && _skidLeft)
+                _skidLeft--;
+            receive(_incoming.front());
+            _incoming.pop_front();
+            _rxNextNs = next + ct;
+        }
+
+        bool cond = thrCondition();
+        if (cond && !_thrPrevious)
+            _thrLatched = true;
+        _thrPrevious = cond;
+    }
+
+    _nowNs = nowNs;
+
+    // A halted remote needs a full character time after resuming
+    if (!_incoming.empty() && remoteHalted() && !_skidLeft)
+        _rxNextNs = _nowNs + ct;
+
+    bool cond = thrCondition();
+    if (cond && !_thrPrevious)
+        _thrLatched = true;
+    _thrPrevious = cond;
+
+    updateIrq();
+}
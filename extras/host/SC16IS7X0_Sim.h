@@ -0,0 +1,291 @@
+/**
+ * @file SC16IS7X0_Sim.h
+ * @brief Simulated SC16IS7X0 behind the SC16IS7X0_BusIo interface
+ * @details Models the register banks selected by LCR (general, special with
+ * LCR[7] = 1, enhanced with LCR = 0xBF, TCR/TLR with MCR[2] = 1 and
+ * EFR[4] = 1), the 64 bytes RX and TX FIFOs shifted at the programmed baudrate,
+ * LSR / IIR / RXLVL / TXLVL, trigger levels, hardware flow control, software
+ * flow control with single XON / XOFF characters (EFR[3:0], MCR[5]), RS-485
+ * direction control and 9-bit multidrop with address detection (EFCR, EFR[5],
+ * XOFF2), special character detect (EFR[5]), the internal loopback (MCR[4],
+ * RTS wired to CTS), the GPIOs, sampled byte by byte within a burst, and the
+ * IRQ output.
+ *
+ * The remote device sending the injected bytes honours RTS and the XOFF / XON
+ * characters transmitted by the chip, after setRtsSkid() characters.
+ *
+ * The device follows HostArduino time. Every bus transaction advances the
+ * virtual clock by the time it would take on the wire, so a test or benchmark
+ * driven by the virtual clock is fully deterministic.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+#include <deque>
+#include <vector>
+
+#include "SC16IS7X0_BusIo.h"
+
+class SC16IS7X0_Sim : public SC16IS7X0_BusIo
+{
+public:
+  /**
+   * @param xtalFreq Frequency in Hz of the simulated crystal
+   * @param bus Transport used to compute the time spent on the bus
+   * @param busFreq SPI clock or I2C SCL frequency in Hz
+   */
+  SC16IS7X0_Sim(uint32_t xtalFreq, ioBus bus = SPI_BUS,
+                uint32_t busFreq = 4000000);
+  ~SC16IS7X0_Sim();
+
+  bool read(uint8_t *buffer, size_t len) override;
+  bool write(const uint8_t *buffer, size_t len,
+             const uint8_t *prefix_buffer = nullptr,
+             size_t prefix_len = 0) override;
+  bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                       uint8_t *read_buffer, size_t read_len) override;
+  size_t maxTransferSize(void) override;
+  bool submit(Transaction *t) override;
+  size_t poll(void) override;
+  void drain(void) override;
+  bool isAsync(void) override { return _async; }
+
+  /**
+   * @brief Model a DMA capable bus: submitted transactions are transferred
+   * one after the other without charging the CPU, and complete from poll()
+   * once the virtual clock has passed their end
+   */
+  void setAsync(bool enable) { _async = enable; }
+
+  /**
+   * @brief Transactions the asynchronous bus holds at once, submit() refuses
+   * more like a full DMA queue. 0 (default) for no limit.
+   */
+  void setQueueDepth(size_t depth) { _queueDepth = depth; }
+
+  /**
+   * @brief Transactions submitted and not completed yet
+   */
+  size_t queued(void) const { return _submitted.size(); }
+
+  /**
+   * @brief Power-on reset, every register back to its default value
+   */
+  void reset(void);
+
+  /**
+   * @brief Set the transport and clock used to compute bus time
+   */
+  void setBus(ioBus bus, uint32_t busFreq);
+
+  /**
+   * @brief Largest transfer (subaddress included) accepted in one
+   * transaction, 0 for no limit. Defaults to 32 bytes on I2C like the
+   * Wire buffer of many cores.
+   */
+  void setMaxTransfer(size_t len) { _maxTransfer = len; }
+
+  /**
+   * @brief Mirror the IRQ output on a HostArduino pin (active low)
+   */
+  void attachIrqPin(uint8_t pin);
+
+  /**
+   * @brief Queue bytes sent by the remote device. They arrive on RX at the
+   * programmed baudrate, one character time apart.
+   */
+  void inject(const uint8_t *data, size_t len);
+  void inject(const char *str) { inject((const uint8_t *)str, strlen(str)); }
+
+  /**
+   * @brief Queue an address character (9th bit set) sent by the remote device
+   */
+  void injectAddress(uint8_t address);
+
+  /**
+   * @brief Bytes shifted out on TX (not in loopback mode) since the last call
+   */
+  std::vector<uint8_t> takeTransmitted(void);
+
+  /**
+   * @brief Same as takeTransmitted() with the parity (9th) bit in bit 8
+   */
+  std::vector<uint16_t> takeTransmitted9(void);
+
+  /**
+   * @brief Drive the CTS input (true = active, transmission allowed)
+   */
+  void setCts(bool active) { _ctsActive = active; }
+
+  /**
+   * @brief Characters the remote still sends after RTS went inactive or after
+   * an XOFF, its reaction time. 0 (default) stops it at the end of the current
+   * character.
+   */
+  void setRtsSkid(uint8_t chars) { _rtsSkid = chars; }
+
+  /**
+   * @brief Level driven on the GPIO configured as inputs
+   */
+  void setInputPins(uint8_t levels);
+
+  /**
+   * @brief Levels driven on the GPIO inputs over time: levels[i] from
+   * i * periodNs after now, the last one afterwards. Sampled when IOSTATE
+   * is read, byte by byte within a burst. Raises no I/O interrupt.
+   */
+  void setInputPattern(const std::vector<uint8_t> &levels, uint32_t periodNs);
+
+  /**
+   * @brief Software flow control mode, EFR[3:0]
+   */
+  uint8_t softwareFlowMode(void) const { return _efr & 0x0F; }
+
+  /**
+   * @brief Current level of the GPIO configured as outputs
+   */
+  uint8_t outputPins(void) const { return _ioState & _ioDir; }
+
+  struct PinSample {
+    uint64_t ns; // End of the data byte on the bus
+    uint8_t levels;
+  };
+
+  /**
+   * @brief Record the outputs at every IOSTATE write, byte by byte within a
+   * burst
+   */
+  void traceOutputs(bool enable) { _traceIo = enable; }
+
+  /**
+   * @brief Outputs recorded since the last call, see traceOutputs()
+   */
+  std::vector<PinSample> takeOutputTrace(void);
+
+  /**
+   * @brief RTS output state (true = active, remote may send)
+   */
+  bool rtsActive(void) const { return _rtsActive; }
+
+  /**
+   * @brief Level of the RTS pin, driven by the transmitter in RS-485 mode
+   * (EFCR[4])
+   */
+  bool rtsHigh(void) const;
+
+  /**
+   * @brief Baudrate programmed through DLL, DLH and MCR[7]
+   */
+  double baudrate(void) const;
+
+  /**
+   * @brief Number of characters lost because the RX FIFO was full
+   */
+  uint32_t overruns(void) const { return _overruns; }
+
+  /**
+   * @brief Time spent on the bus, in microseconds
+   */
+  uint64_t busTimeUs(void) const { return _busTimeNs / 1000; }
+
+  /**
+   * @brief Bring the UART up to date with HostArduino time
+   */
+  void update(void);
+
+  uint8_t rxlvl(void) const { return (uint8_t)_rxFifo.size(); }
+  uint8_t txlvl(void) const { return (uint8_t)(FIFO - _txFifo.size()); }
+
+private:
+  static constexpr size_t FIFO = 64;
+
+  struct RxChar {
+    uint8_t data;
+    uint8_t error; // LSR[4:2] bits attached to the character
+  };
+
+  static void tick(void *arg, uint64_t nowUs);
+
+  struct Pending {
+    Transaction *t;
+    uint64_t endNs;
+  };
+
+  uint64_t busTimeNs(size_t bytes, bool repeatedStart) const;
+  void spendBusTime(size_t bytes, bool repeatedStart);
+  bool complete(uint64_t nowNs);
+  uint8_t readReg(uint8_t reg);
+  void writeReg(uint8_t reg, uint8_t val);
+  void advanceTo(uint64_t nowNs);
+  void receive(int c);
+  void updateFlowControl(void);
+  bool receiveControl(uint8_t c);
+  bool receiveMultidrop(int c);
+  bool txParityBit(uint8_t c) const;
+  void sendControl(bool xon);
+  bool remoteHalted(void) const;
+  void updateIrq(void);
+  uint8_t iir(void);
+  uint8_t lsr(void);
+  uint32_t charTimeNs(void) const;
+  uint8_t rxTrigger(void) const;
+  uint8_t txTrigger(void) const;
+  bool enhanced(void) const { return _lcr == 0xBF; }
+  bool special(void) const { return (_lcr & 0x80) != 0; }
+  bool tcrTlr(void) const { return (_mcr & 0x04) && (_efr & 0x10); }
+  bool thrCondition(void) const;
+  uint8_t inputPins(void) const;
+
+  uint32_t _xtalFreq;
+  ioBus _bus;
+  uint32_t _busFreq;
+  size_t _maxTransfer;
+  int _irqPin;
+  bool _async;
+  bool _dma;
+  size_t _queueDepth;
+  std::deque<Pending> _submitted;
+  uint64_t _dmaEndNs;
+  bool _irqAsserted;
+
+  uint8_t _ier, _fcr, _lcr, _mcr, _spr, _tcr, _tlr;
+  uint8_t _dll, _dlh, _efr, _xon1, _xon2, _xoff1, _xoff2;
+  uint8_t _ioDir, _ioState, _ioIntEna, _ioControl, _efcr;
+  uint8_t _ioInputs, _ioLatched;
+  bool _ioChanged;
+
+  std::deque<RxChar> _rxFifo;
+  std::deque<uint8_t> _txFifo;
+  std::deque<uint16_t> _incoming;    // 9th bit in bit 8
+  std::vector<uint16_t> _transmitted; // 9th bit in bit 8
+
+  bool _overrun;
+  bool _thrLatched;
+  bool _thrPrevious;
+  bool _ctsActive;
+  bool _rtsActive;
+  uint8_t _skidLeft;
+  std::deque<uint8_t> _txControl; // XON / XOFF waiting for the transmitter
+  bool _xoffSent;
+  bool _txHeld;     // XOFF received
+  bool _remoteHeld; // XOFF transmitted
+  bool _xoffLatched;
+  bool _txShiftControl;
+  bool _addressed; // Address detection, last address matched XOFF2
+  bool _txBusy;
+  uint16_t _txShift;
+  uint64_t _txEndNs;
+  uint64_t _rxNextNs;
+  uint64_t _rxLastNs;
+  uint64_t _nowNs;
+  uint64_t _busTimeNs;
+  uint32_t _overruns;
+  uint8_t _rtsSkid;
+  uint64_t _accessNs; // End of the byte of the register access in progress
+  std::vector<uint8_t> _inputPattern;
+  uint64_t _inputPatternStartNs;
+  uint32_t _inputPatternNs;
+  bool _traceIo;
+  std::vector<PinSample> _ioTrace;
+};
@@ -0,0 +1,8 @@
+/**
+ * @file Adafruit_BusIO_Register.h
+ * @brief Placeholder of the host Arduino shim
+ */
+#pragma once
+
+#include <Adafruit_I2CDevice.h>
+#include <Adafruit_SPIDevice.h>
@@ -0,0 +1,52 @@
+/**
+ * @file Adafruit_I2CDevice.h
+ * @brief Adafruit_I2CDevice placeholder of the host Arduino shim. There is no
+ * I2C hardware on the host, every transfer fails.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class Adafruit_I2CDevice {
+public:
+  Adafruit_I2CDevice(uint8_t addr, TwoWire *theWire = &Wire) : _addr(addr) {
+    (void)theWire;
+  }
+
+  uint8_t address(void) { return _addr; }
+  bool begin(bool addr_detect = true) {
+    (void)addr_detect;
+    return false;
+  }
+  bool detected(void) { return false; }
+  bool read(uint8_t *buffer, size_t len, bool stop = true) {
+    (void)buffer;
+    (void)len;
+    (void)stop;
+    return false;
+  }
+  bool write(const uint8_t *buffer, size_t len, bool stop = true,
+             const uint8_t *prefix_buffer = nullptr, size_t prefix_len = 0) {
+    (void)buffer;
+    (void)len;
+    (void)stop;
+    (void)prefix_buffer;
+    (void)prefix_len;
+    return false;
+  }
+  bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                       uint8_t *read_buffer, size_t read_len,
+                       bool stop = false) {
+    (void)write_buffer;
+    (void)write_len;
+    (void)read_buffer;
+    (void)read_len;
+    (void)stop;
+    return false;
+  }
+  size_t maxBufferSize() { return 32; }
+
+private:
+  uint8_t _addr;
+};
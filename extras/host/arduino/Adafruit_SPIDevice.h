@@ -0,0 +1,70 @@
+/**
+ * @file Adafruit_SPIDevice.h
+ * @brief Adafruit_SPIDevice placeholder of the host Arduino shim. There is no
+ * SPI hardware on the host, every transfer fails. The SPISettings is allocated
+ * on the heap like in the Arduino library, so that allocation counts hold on
+ * the target.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <SPI.h>
+
+typedef enum _BitOrder {
+  SPI_BITORDER_MSBFIRST = 1,
+  SPI_BITORDER_LSBFIRST = 0,
+} BusIOBitOrder;
+
+class Adafruit_SPIDevice {
+public:
+  Adafruit_SPIDevice(int8_t cspin, uint32_t freq = 1000000,
+                     BusIOBitOrder dataOrder = SPI_BITORDER_MSBFIRST,
+                     uint8_t dataMode = SPI_MODE0, SPIClass *theSPI = &SPI) {
+    (void)cspin;
+    (void)theSPI;
+    // As the Arduino library does for hardware SPI
+    _spiSetting = new SPISettings(freq, dataOrder, dataMode);
+  }
+  ~Adafruit_SPIDevice() { delete _spiSetting; }
+  Adafruit_SPIDevice(const Adafruit_SPIDevice &) = delete;
+  Adafruit_SPIDevice &operator=(const Adafruit_SPIDevice &) = delete;
+
+  bool begin(void) { return false; }
+  bool read(uint8_t *buffer, size_t len, uint8_t sendvalue = 0xFF) {
+    (void)buffer;
+    (void)len;
+    (void)sendvalue;
+    return false;
+  }
+  bool write(const uint8_t *buffer, size_t len,
+             const uint8_t *prefix_buffer = nullptr, size_t prefix_len = 0) {
+    (void)buffer;
+    (void)len;
+    (void)prefix_buffer;
+    (void)prefix_len;
+    return false;
+  }
+  bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                       uint8_t *read_buffer, size_t read_len,
+                       uint8_t sendvalue = 0xFF) {
+    (void)write_buffer;
+    (void)write_len;
+    (void)read_buffer;
+    (void)read_len;
+    (void)sendvalue;
+    return false;
+  }
+  void transfer(uint8_t *buffer, size_t len) {
+    (void)buffer;
+    (void)len;
+  }
+  uint8_t transfer(uint8_t send) { return send; }
+  void beginTransaction(void) {}
+  void endTransaction(void) {}
+  void beginTransactionWithAssertingCS(void) {}
+  void endTransactionWithDeassertingCS(void) {}
+  void setChipSelect(int value) { (void)value; }
+
+private:
+  SPISettings *_spiSetting;
+};
@@ -0,0 +1,186 @@
+/**
+ * @file Arduino.cpp
+ * @brief Time, pin and interrupt emulation of the host Arduino shim
+ */
+#include "Arduino.h"
+#include "SPI.h"
+#include "Wire.h"
+
+#include <time.h>
+
+SPIClass SPI;
+TwoWire Wire;
+
+namespace {
+
+constexpr uint8_t PIN_COUNT = 64;
+constexpr uint8_t TICK_HOOKS = 32;
+
+struct PinState {
+  uint8_t mode;
+  uint8_t level;
+  void (*handler)(void *);
+  void *arg;
+  int irqMode;
+  uint8_t pullers;
+};
+
+struct TickHook {
+  void (*hook)(void *arg, uint64_t nowUs);
+  void *arg;
+};
+
+bool virtualTime = false;
+uint64_t virtualUs = 0;
+uint64_t realOrigin = 0;
+PinState pins[PIN_COUNT];
+TickHook tickHooks[TICK_HOOKS];
+bool inTick = false;
+
+uint64_t monotonicUs(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+void runTickHooks(void) {
+  // A hook may toggle a pin whose interrupt handler reads the clock again
+  if (inTick)
+    return;
+  inTick = true;
+  uint64_t now = HostArduino::nowMicros();
+  for (auto &t : tickHooks) {
+    if (t.hook)
+      t.hook(t.arg, now);
+  }
+  inTick = false;
+}
+
+} // namespace
+
+namespace HostArduino {
+
+void useVirtualTime(bool enable) {
+  virtualTime = enable;
+  if (!enable)
+    realOrigin = monotonicUs();
+}
+
+void advanceMicros(uint64_t us) {
+  if (virtualTime)
+    virtualUs += us;
+  runTickHooks();
+}
+
+uint64_t nowMicros(void) {
+  if (virtualTime)
+    return virtualUs;
+  if (realOrigin == 0)
+    realOrigin = monotonicUs();
+  return monotonicUs() - realOrigin;
+}
+
+void onTick(void (*hook)(void *arg, uint64_t nowUs), void *arg) {
+  for (auto &t : tickHooks) {
+    if (t.hook == nullptr) {
+      t.hook = hook;
+      t.arg = arg;
+      return;
+    }
+  }
+  assert(false && "too many tick hooks");
+}
+
+void removeTick(void (*hook)(void *arg, uint64_t nowUs), void *arg) {
+  for (auto &t : tickHooks) {
+    if (t.hook == hook && t.arg == arg) {
+      t.hook = nullptr;
+      t.arg = nullptr;
+    }
+  }
+}
+
+void pullPinLow(uint8_t pin, bool low) {
+  assert(pin < PIN_COUNT);
+  PinState &p = pins[pin];
+  if (low)
+    p.pullers++;
+  else if (p.pullers > 0)
+    p.pullers--;
+  setPinLevel(pin, p.pullers ? LOW : HIGH);
+}
+
+void setPinLevel(uint8_t pin, uint8_t level) {
+  assert(pin < PIN_COUNT);
+  PinState &p = pins[pin];
+  uint8_t old = p.level;
+  p.level = level ? HIGH : LOW;
+  if (p.handler == nullptr || old == p.level)
+    return;
+
+  bool falling = (old == HIGH && p.level == LOW);
+  if (p.irqMode == CHANGE || (p.irqMode == FALLING && falling) ||
+      (p.irqMode == RISING && !falling))
+    p.handler(p.arg);
+}
+
+} // namespace HostArduino
+
+uint32_t micros(void) { return (uint32_t)HostArduino::nowMicros(); }
+
+uint32_t millis(void) { return (uint32_t)(HostArduino::nowMicros() / 1000); }
+
+void delay(uint32_t ms) { delayMicroseconds(ms * 1000); }
+
+void delayMicroseconds(uint32_t us) {
+  if (virtualTime) {
+    HostArduino::advanceMicros(us);
+    return;
+  }
+  uint64_t end = HostArduino::nowMicros() + us;
+  while (HostArduino::nowMicros() < end)
+    runTickHooks();
+}
+
+void yield(void) {
+  // Let simulated peripherals make progress while the caller spins
+  if (virtualTime)
+    HostArduino::advanceMicros(1);
+  else
+    runTickHooks();
+}
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  assert(pin < PIN_COUNT);
+  pins[pin].mode = mode;
+  if (mode == INPUT_PULLUP && pins[pin].handler == nullptr)
+    pins[pin].level = HIGH;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  assert(pin < PIN_COUNT);
+  pins[pin].level = val ? HIGH : LOW;
+}
+
+int digitalRead(uint8_t pin) {
+  assert(pin < PIN_COUNT);
+  return pins[pin].level;
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg,
+                        int mode) {
+  assert(pin < PIN_COUNT);
+  pins[pin].handler = handler;
+  pins[pin].arg = arg;
+  pins[pin].irqMode = mode;
+}
+
+void detachInterrupt(uint8_t pin) {
+  assert(pin < PIN_COUNT);
+  pins[pin].handler = nullptr;
+  pins[pin].arg = nullptr;
+}
+
+void noInterrupts(void) {}
+
+void interrupts(void) {}
@@ -0,0 +1,93 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core shim used to build the library on a Linux host
+ * @details Only what the SC16IS7X0 library and its host tools need. Time is
+ * either the real monotonic clock or a virtual clock advanced explicitly (see
+ * HostArduino), which lets the simulated device run deterministically.
+ */
+#pragma once
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+
+#define LOW 0x0
+#define HIGH 0x1
+
+#define INPUT 0x00
+#define OUTPUT 0x01
+#define INPUT_PULLUP 0x02
+
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define NOT_AN_INTERRUPT -1
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+uint32_t micros(void);
+uint32_t millis(void);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield(void);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+static inline int digitalPinToInterrupt(uint8_t pin) { return (int)pin; }
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg,
+                        int mode);
+void detachInterrupt(uint8_t pin);
+
+void noInterrupts(void);
+void interrupts(void);
+
+namespace HostArduino {
+
+/**
+ * @brief Select the virtual clock (true) or the real monotonic clock (false)
+ */
+void useVirtualTime(bool enable);
+
+/**
+ * @brief Advance the virtual clock. Registered tick hooks are called so that
+ * simulated peripherals can follow.
+ */
+void advanceMicros(uint64_t us);
+
+/**
+ * @brief Current time in microseconds, without the 32-bit wrap of micros()
+ */
+uint64_t nowMicros(void);
+
+/**
+ * @brief Register a hook called every time the virtual clock advances
+ */
+void onTick(void (*hook)(void *arg, uint64_t nowUs), void *arg);
+void removeTick(void (*hook)(void *arg, uint64_t nowUs), void *arg);
+
+/**
+ * @brief Drive an input pin from the outside world (e.g. a simulated IRQ
+ * output). Interrupt handlers attached to the pin are called on matching
+ * edges.
+ */
+void setPinLevel(uint8_t pin, uint8_t level);
+
+/**
+ * @brief Assert or release an open-drain output wired to a pin. The pin is
+ * low while at least one output pulls it low (wired-OR IRQ lines).
+ */
+void pullPinLow(uint8_t pin, bool low);
+
+} // namespace HostArduino
+
+#include "HardwareSerial.h"
+#include "Stream.h"
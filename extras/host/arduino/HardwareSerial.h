@@ -0,0 +1,49 @@
+/**
+ * @file HardwareSerial.h
+ * @brief SerialConfig values of the ESP8266 core, used by the host shim
+ */
+#pragma once
+
+#include <stdint.h>
+
+#define UART_NB_BIT_MASK 0B00001100
+#define UART_NB_BIT_5 0B00000000
+#define UART_NB_BIT_6 0B00000100
+#define UART_NB_BIT_7 0B00001000
+#define UART_NB_BIT_8 0B00001100
+
+#define UART_PARITY_MASK 0B00000011
+#define UART_PARITY_NONE 0B00000000
+#define UART_PARITY_EVEN 0B00000010
+#define UART_PARITY_ODD 0B00000011
+
+#define UART_NB_STOP_BIT_MASK 0B00110000
+#define UART_NB_STOP_BIT_1 0B00010000
+#define UART_NB_STOP_BIT_2 0B00110000
+
+enum SerialConfig {
+  SERIAL_5N1 = UART_NB_BIT_5 | UART_PARITY_NONE | UART_NB_STOP_BIT_1,
+  SERIAL_6N1 = UART_NB_BIT_6 | UART_PARITY_NONE | UART_NB_STOP_BIT_1,
+  SERIAL_7N1 = UART_NB_BIT_7 | UART_PARITY_NONE | UART_NB_STOP_BIT_1,
+  SERIAL_8N1 = UART_NB_BIT_8 | UART_PARITY_NONE | UART_NB_STOP_BIT_1,
+  SERIAL_5N2 = UART_NB_BIT_5 | UART_PARITY_NONE | UART_NB_STOP_BIT_2,
+  SERIAL_6N2 = UART_NB_BIT_6 | UART_PARITY_NONE | UART_NB_STOP_BIT_2,
+  SERIAL_7N2 = UART_NB_BIT_7 | UART_PARITY_NONE | UART_NB_STOP_BIT_2,
+  SERIAL_8N2 = UART_NB_BIT_8 | UART_PARITY_NONE | UART_NB_STOP_BIT_2,
+  SERIAL_5E1 = UART_NB_BIT_5 | UART_PARITY_EVEN | UART_NB_STOP_BIT_1,
+  SERIAL_6E1 = UART_NB_BIT_6 | UART_PARITY_EVEN | UART_NB_STOP_BIT_1,
+  SERIAL_7E1 = UART_NB_BIT_7 | UART_PARITY_EVEN | UART_NB_STOP_BIT_1,
+  SERIAL_8E1 = UART_NB_BIT_8 | UART_PARITY_EVEN | UART_NB_STOP_BIT_1,
+  SERIAL_5E2 = UART_NB_BIT_5 | UART_PARITY_EVEN | UART_NB_STOP_BIT_2,
+  SERIAL_6E2 = UART_NB_BIT_6 | UART_PARITY_EVEN | UART_NB_STOP_BIT_2,
+  SERIAL_7E2 = UART_NB_BIT_7 | UART_PARITY_EVEN | UART_NB_STOP_BIT_2,
+  SERIAL_8E2 = UART_NB_BIT_8 | UART_PARITY_EVEN | UART_NB_STOP_BIT_2,
+  SERIAL_5O1 = UART_NB_BIT_5 | UART_PARITY_ODD | UART_NB_STOP_BIT_1,
+  SERIAL_6O1 = UART_NB_BIT_6 | UART_PARITY_ODD | UART_NB_STOP_BIT_1,
+  SERIAL_7O1 = UART_NB_BIT_7 | UART_PARITY_ODD | UART_NB_STOP_BIT_1,
+  SERIAL_8O1 = UART_NB_BIT_8 | UART_PARITY_ODD | UART_NB_STOP_BIT_1,
+  SERIAL_5O2 = UART_NB_BIT_5 | UART_PARITY_ODD | UART_NB_STOP_BIT_2,
+  SERIAL_6O2 = UART_NB_BIT_6 | UART_PARITY_ODD | UART_NB_STOP_BIT_2,
+  SERIAL_7O2 = UART_NB_BIT_7 | UART_PARITY_ODD | UART_NB_STOP_BIT_2,
+  SERIAL_8O2 = UART_NB_BIT_8 | UART_PARITY_ODD | UART_NB_STOP_BIT_2,
+};
@@ -0,0 +1,57 @@
+/**
+ * @file Print.h
+ * @brief Minimal Print class of the host Arduino shim
+ */
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+      if (write(*buffer++))
+        n++;
+      else
+        break;
+    }
+    return n;
+  }
+  size_t write(const char *str) {
+    if (str == nullptr)
+      return 0;
+    return write((const uint8_t *)str, strlen(str));
+  }
+  size_t write(const char *buffer, size_t size) {
+    return write((const uint8_t *)buffer, size);
+  }
+  virtual int availableForWrite() { return 0; }
+  virtual void flush() {}
+
+  size_t print(const char *str) { return write(str); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t println(const char *str) { return print(str) + print("\r\n"); }
+  size_t println(void) { return print("\r\n"); }
+
+  size_t printf(const char *format, ...)
+      __attribute__((format(printf, 2, 3))) {
+    char buf[256];
+    va_list arg;
+    va_start(arg, format);
+    int len = vsnprintf(buf, sizeof(buf), format, arg);
+    va_end(arg);
+    if (len < 0)
+      return 0;
+    if ((size_t)len >= sizeof(buf))
+      len = sizeof(buf) - 1;
+    return write((const uint8_t *)buf, (size_t)len);
+  }
+};
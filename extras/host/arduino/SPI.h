@@ -0,0 +1,43 @@
+/**
+ * @file SPI.h
+ * @brief SPI class placeholder of the host Arduino shim. There is no SPI
+ * hardware on the host: nothing drives MISO, every byte reads as 0xFF.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x01
+#define SPI_MODE2 0x02
+#define SPI_MODE3 0x03
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+class SPISettings {
+public:
+  SPISettings() : _clock(1000000), _bitOrder(MSBFIRST), _dataMode(SPI_MODE0) {}
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+      : _clock(clock), _bitOrder(bitOrder), _dataMode(dataMode) {}
+
+  uint32_t _clock;
+  uint8_t _bitOrder;
+  uint8_t _dataMode;
+};
+
+class SPIClass {
+public:
+  void begin(void) {}
+  void end(void) {}
+  void beginTransaction(SPISettings settings) { (void)settings; }
+  void endTransaction(void) {}
+  uint8_t transfer(uint8_t data) {
+    (void)data;
+    return 0xFF;
+  }
+  void transfer(void *buffer, size_t len) { memset(buffer, 0xFF, len); }
+};
+extern SPIClass SPI;
@@ -0,0 +1,50 @@
+/**
+ * @file Stream.h
+ * @brief Minimal Stream class of the host Arduino shim (ESP32 flavour:
+ * readBytes(uint8_t *, size_t) is the virtual bulk read)
+ */
+#pragma once
+
+#include "Print.h"
+
+uint32_t millis(void);
+void yield(void);
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  unsigned long getTimeout(void) { return _timeout; }
+
+  virtual size_t readBytes(uint8_t *buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+      int c = timedRead();
+      if (c < 0)
+        break;
+      *buffer++ = (uint8_t)c;
+      count++;
+    }
+    return count;
+  }
+  size_t readBytes(char *buffer, size_t length) {
+    return readBytes((uint8_t *)buffer, length);
+  }
+
+protected:
+  int timedRead() {
+    uint32_t start = millis();
+    do {
+      int c = read();
+      if (c >= 0)
+        return c;
+      yield();
+    } while (millis() - start < _timeout);
+    return -1;
+  }
+
+  unsigned long _timeout = 1000;
+};
@@ -0,0 +1,8 @@
+/**
+ * @file Wire.h
+ * @brief TwoWire placeholder of the host Arduino shim
+ */
+#pragma once
+
+class TwoWire {};
+extern TwoWire Wire;
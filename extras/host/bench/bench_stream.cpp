@@ -0,0 +1,267 @@
+/**
+ * @file bench_stream.cpp
+ * @brief Bus cost and throughput of the Stream methods against the simulated
+ * device
+ * @details Every case runs on a fresh device behind SC16IS7X0_BusIoCounter,
+ * for SPI and I2C at two clocks each, three baudrates and both the polled and
+ * the IRQ mode. One JSON object is printed per case and per line:
+ *
+ *   bench        measured path
+ *   bus, bus_hz  transport and its clock
+ *   baud, mode   UART baudrate, "poll" or "irq"
+ *   ops          payload bytes, or calls for available_idle / digitalRead /
+ *                service_idle
+ *   transactions, bytes_out, bytes_in  counted by SC16IS7X0_BusIoCounter
+ *   tx_per_op    transactions per op
+ *   wire_per_op  bytes on the bus (subaddresses included, I2C address bytes
+ *                excluded) per op
+ *   bus_us       time spent on the bus
+ *   elapsed_us   time of the whole case
+ *   ops_per_s    sustained rate, line_ratio compares it with the baudrate
+ *                (1.0 = the line is never idle) for the data paths
+ *   lost         payload bytes not received or not transmitted in time
+ *   overruns     characters dropped by the RX FIFO of the simulated chip
+ *
+ * Runs on the virtual clock: the output is the same on every run and can be
+ * compared between releases (make bench > bench.jsonl).
+ */
+#include <Arduino.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_BusIoCounter.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint8_t IRQ_PIN = 4;
+constexpr size_t PAYLOAD = 1024;
+constexpr size_t CALLS = 1000;
+constexpr size_t READ_CHUNK = 64;
+constexpr size_t SERVICE_PAYLOAD = 200; // Fits the software RX buffer
+constexpr uint32_t SERVICE_LOOP_US = 5;
+constexpr uint32_t SERVICE_IDLE_US = 100000;
+
+struct Transport
+{
+    const char *name;
+    SC16IS7X0_BusIo::ioBus bus;
+    uint32_t freq;
+};
+
+static const Transport transports[] = {
+    {"spi", SC16IS7X0_BusIo::SPI_BUS, 4000000},
+    {"spi", SC16IS7X0_BusIo::SPI_BUS, 15000000},
+    {"i2c", SC16IS7X0_BusIo::I2C_BUS, 400000},
+    {"i2c", SC16IS7X0_BusIo::I2C_BUS, 1000000},
+};
+
+static const uint32_t baudrates[] = {9600, 115200, 921600};
+
+/**
+ * @brief Device, simulated chip and counter of one case
+ */
+struct Bench
+{
+    SC16IS7X0_Sim *sim; // Owned by counter
+    std::unique_ptr<SC16IS7X0_BusIoCounter> counter;
+    SC16IS7X0 uart; // Released before counter
+    const Transport &transport;
+    uint32_t baud;
+    bool irq;
+    uint64_t start;
+
+    Bench(const Transport &t, uint32_t baudrate, bool irqMode)
+        : sim(new SC16IS7X0_Sim(CRYSTAL_FREQ, t.bus, t.freq)),
+          counter(new SC16IS7X0_BusIoCounter(sim)), uart(CRYSTAL_FREQ),
+          transport(t), baud(baudrate), irq(irqMode)
+    {
+        uart.begin(*counter);
+        uart.begin_UART(baud);
+        if (irq) {
+            sim->attachIrqPin(IRQ_PIN);
+            uart.enableInterrupt(IRQ_PIN);
+        }
+
+        // Setup is not measured
+        counter->reset();
+        start = HostArduino::nowMicros();
+    }
+
+    uint64_t charTimeUs(void) const { return uart.getCharTimeNs() / 1000 + 1; }
+
+    void report(const char *name, size_t ops, size_t lost, bool dataPath)
+    {
+        const SC16IS7X0_BusIoCounter::Stats &s = counter->stats();
+        uint64_t elapsed = HostArduino::nowMicros() - start;
+        double rate = elapsed ? ops * 1e6 / elapsed : 0.0;
+
+        printf("{\"bench\":\"%s\",\"bus\":\"%s\",\"bus_hz\":%u,\"baud\":%u,"
+               "\"mode\":\"%s\",\"ops\":%zu,\"transactions\":%u,"
+               "\"bytes_out\":%u,\"bytes_in\":%u,\"tx_per_op\":%.3f,"
+               "\"wire_per_op\":%.3f,\"bus_us\":%u,\"elapsed_us\":%llu,"
+               "\"ops_per_s\":%.1f",
+               name, transport.name, transport.freq, baud, irq ? "irq" : "poll",
+               ops, s.transactions, s.bytesOut, s.bytesIn,
+               (double)s.transactions / ops,
+               (double)(s.bytesOut + s.bytesIn) / ops, s.busyUs,
+               (unsigned long long)elapsed, rate);
+        if (dataPath) {
+            // Characters per second the line can carry
+            double line = 1e9 / uart.getCharTimeNs();
+            printf(",\"line_ratio\":%.3f,\"lost\":%zu,\"overruns\":%u",
+                   rate / line, lost, sim->overruns());
+        }
+        printf("}\n");
+    }
+};
+
+static std::vector<uint8_t> pattern(size_t len)
+{
+    std::vector<uint8_t> data(len);
+    for (size_t i = 0; i < len; i++)
+        data[i] = (uint8_t)(i * 7 + 3);
+    return data;
+}
+
+/**
+ * @brief Wait until the payload has been shifted out on TX
+ * @details Polls once per character time like an application loop, flush()
+ * is measured on its own.
+ */
+static size_t waitTransmitted(Bench &b, size_t len)
+{
+    size_t sent = 0;
+    uint64_t deadline = b.start + 2 * len * b.charTimeUs() + 100000;
+    while (sent < len && HostArduino::nowMicros() < deadline) {
+        b.uart.service();
+        delayMicroseconds(b.charTimeUs());
+        sent += b.sim->takeTransmitted().size();
+    }
+    return len - sent;
+}
+
+static void benchWriteByte(Bench &b)
+{
+    std::vector<uint8_t> data = pattern(PAYLOAD);
+    for (uint8_t c : data)
+        b.uart.write(c);
+    b.report("write_byte", PAYLOAD, waitTransmitted(b, PAYLOAD), true);
+}
+
+static void benchWriteBuffer(Bench &b)
+{
+    std::vector<uint8_t> data = pattern(PAYLOAD);
+    b.uart.write(data.data(), data.size());
+    b.report("write_buf", PAYLOAD, waitTransmitted(b, PAYLOAD), true);
+}
+
+/**
+ * @brief One FIFO worth of data written then flush()
+ */
+static void benchFlush(Bench &b)
+{
+    std::vector<uint8_t> data = pattern(SC16IS7X0_FIFO_SIZE);
+    b.uart.write(data.data(), data.size());
+    b.uart.flush();
+    b.report("flush", data.size(), data.size() - b.sim->takeTransmitted().size(), true);
+}
+
+/**
+ * @brief Receive the payload injected on RX, with read() (chunk = 0) or
+ * readBytes()
+ * @details The loop waits one character time when nothing is available.
+ */
+static void benchRead(Bench &b, const char *name, size_t chunk)
+{
+    std::vector<uint8_t> data = pattern(PAYLOAD);
+    b.sim->inject(data.data(), data.size());
+
+    std::vector<uint8_t> received;
+    uint64_t deadline = b.start + 2 * PAYLOAD * b.charTimeUs() + 100000;
+    uint8_t buffer[READ_CHUNK];
+    while (received.size() < PAYLOAD && HostArduino::nowMicros() < deadline) {
+        size_t n = 0;
+        if (chunk) {
+            n = b.uart.readBytes(buffer, chunk);
+            received.insert(received.end(), buffer, buffer + n);
+        } else {
+            while (b.uart.available()) {
+                received.push_back((uint8_t)b.uart.read());
+                n++;
+            }
+        }
+        if (n == 0)
+            delayMicroseconds(b.charTimeUs());
+    }
+
+    b.report(name, PAYLOAD, PAYLOAD - received.size(), true);
+}
+
+/**
+ * @brief Reception driven by service() alone, called every SERVICE_LOOP_US
+ */
+static void benchServiceRx(Bench &b)
+{
+    std::vector<uint8_t> data = pattern(SERVICE_PAYLOAD);
+    b.sim->inject(data.data(), data.size());
+
+    uint64_t end = b.start + (SERVICE_PAYLOAD + SC16IS7X0_FIFO_SIZE) * b.charTimeUs();
+    while (HostArduino::nowMicros() < end) {
+        b.uart.service();
+        delayMicroseconds(SERVICE_LOOP_US);
+    }
+    b.report("service_rx", SERVICE_PAYLOAD, SERVICE_PAYLOAD - b.uart.stats().rxBytes, true);
+}
+
+/**
+ * @brief service() called every SERVICE_LOOP_US on an idle port
+ */
+static void benchServiceIdle(Bench &b)
+{
+    size_t calls = 0;
+    while (HostArduino::nowMicros() - b.start < SERVICE_IDLE_US) {
+        b.uart.service();
+        delayMicroseconds(SERVICE_LOOP_US);
+        calls++;
+    }
+    b.report("service_idle", calls, 0, false);
+}
+
+static void benchAvailableIdle(Bench &b)
+{
+    for (size_t i = 0; i < CALLS; i++)
+        b.uart.available();
+    b.report("available_idle", CALLS, 0, false);
+}
+
+static void benchDigitalRead(Bench &b)
+{
+    for (size_t i = 0; i < CALLS; i++)
+        b.uart.digitalRead(i & 0x07);
+    b.report("digitalRead", CALLS, 0, false);
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    for (const Transport &t : transports) {
+        for (uint32_t baud : baudrates) {
+            for (bool irq : {false, true}) {
+                { Bench b(t, baud, irq); benchWriteByte(b); }
+                { Bench b(t, baud, irq); benchWriteBuffer(b); }
+                { Bench b(t, baud, irq); benchFlush(b); }
+                { Bench b(t, baud, irq); benchRead(b, "read_byte", 0); }
+                { Bench b(t, baud, irq); benchRead(b, "read_buf", READ_CHUNK); }
+                { Bench b(t, baud, irq); benchServiceRx(b); }
+                { Bench b(t, baud, irq); benchServiceIdle(b); }
+                { Bench b(t, baud, irq); benchAvailableIdle(b); }
+                { Bench b(t, baud, irq); benchDigitalRead(b); }
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file sim_async.cpp
+ * @brief Asynchronous bus (begin_SPI_DMA()) against the simulated device
+ * @details The simulated bus runs in asynchronous mode: RXLVL reads, RX
+ * bursts and TX bursts are submitted, transferred without the CPU and their
+ * callbacks run from poll(). 2048 bytes are sent and received at the same
+ * time, at 921600 baud over SPI at 4 MHz, with service() called at
+ * nextServiceDeadline():
+ * - both directions must arrive in order, without RX FIFO overrun
+ * - every submitted transaction must complete through its callback, RXLVL
+ *   reads, RX bursts and TX bursts alike
+ * - with a queue of one transaction, submit() is refused and the driver must
+ *   retry without losing or reordering anything
+ * - flush() reads LSR synchronously: the transactions in flight must be
+ *   drained first
+ * Runs on the virtual clock.
+ */
+#include <Arduino.h>
+
+#include <map>
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t UART_BAUD = 921600;
+constexpr size_t LEN = 2048;
+
+/**
+ * @brief Simulated device counting the transactions and their callbacks
+ */
+class CountingSim : public SC16IS7X0_Sim
+{
+public:
+    struct Counts {
+        uint32_t submitted;
+        uint32_t refused;
+        uint32_t rxLevel; // Callbacks of RXLVL reads
+        uint32_t rxData;  // Callbacks of RHR bursts
+        uint32_t txDone;  // Callbacks of THR bursts
+        uint32_t drains;  // drain() with transactions in flight
+    };
+
+    CountingSim(ioBus bus, uint32_t busFreq)
+        : SC16IS7X0_Sim(CRYSTAL_FREQ, bus, busFreq), counts()
+    {
+    }
+
+    bool submit(Transaction *t) override
+    {
+        // The driver sets done and arg again before every submit()
+        Callback &cb = callbacks[t];
+        cb = {this, t, t->done, t->arg};
+        t->done = done;
+        t->arg = &cb;
+
+        bool ok = SC16IS7X0_Sim::submit(t);
+        if (ok) {
+            counts.submitted++;
+        } else {
+            counts.refused++;
+            t->done = cb.done;
+            t->arg = cb.arg;
+        }
+        return ok;
+    }
+
+    void drain(void) override
+    {
+        if (queued())
+            counts.drains++;
+        SC16IS7X0_Sim::drain();
+    }
+
+    uint32_t callbacksRun(void) const
+    {
+        return counts.rxLevel + counts.rxData + counts.txDone;
+    }
+
+    Counts counts;
+
+private:
+    struct Callback {
+        CountingSim *sim;
+        Transaction *t;
+        void (*done)(void *arg, bool ok);
+        void *arg;
+    };
+
+    static void done(void *arg, bool ok)
+    {
+        Callback cb = *static_cast<Callback *>(arg);
+        uint8_t reg = (cb.t->tx[0] >> 3) & 0x0F;
+        if (cb.t->rx_len == 0)
+            cb.sim->counts.txDone++;
+        else if (reg == SC16IS7X0_RXLVL)
+            cb.sim->counts.rxLevel++;
+        else
+            cb.sim->counts.rxData++;
+
+        // May submit again the same transaction
+        cb.t->done = cb.done;
+        cb.t->arg = cb.arg;
+        cb.done(cb.arg, ok);
+    }
+
+    std::map<Transaction *, Callback> callbacks;
+};
+
+static std::vector<uint8_t> pattern(size_t len, uint8_t mul, uint8_t add)
+{
+    std::vector<uint8_t> data(len);
+    for (size_t i = 0; i < len; i++)
+        data[i] = (uint8_t)(i * mul + add);
+    return data;
+}
+
+static bool stream(const char *name, size_t depth)
+{
+    CountingSim sim(SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    sim.setAsync(true);
+    sim.setQueueDepth(depth);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(UART_BAUD);
+    sim.counts = {};
+
+    std::vector<uint8_t> up = pattern(LEN, 7, 3), down = pattern(LEN, 13, 1);
+    sim.inject(down.data(), down.size());
+
+    std::vector<uint8_t> received, sent;
+    size_t written = 0;
+    uint32_t start = micros();
+    while ((received.size() < LEN || sent.size() < LEN) &&
+           micros() - start < 2 * LEN * sc16is750.getCharTimeNs() / 1000) {
+        // As much as the software TX buffer takes, without blocking
+        size_t room = (size_t)sc16is750.availableForWrite();
+        if (room > LEN - written)
+            room = LEN - written;
+        written += sc16is750.write(up.data() + written, room);
+
+        int32_t us = (int32_t)(sc16is750.nextServiceDeadline() - micros());
+        delayMicroseconds(us > 0 ? us : 1);
+        sc16is750.service();
+
+        uint8_t buffer[64];
+        size_t n;
+        while ((n = sc16is750.readBytes(buffer, sizeof(buffer))) > 0)
+            received.insert(received.end(), buffer, buffer + n);
+        std::vector<uint8_t> tx = sim.takeTransmitted();
+        sent.insert(sent.end(), tx.begin(), tx.end());
+    }
+
+    // LSR is read synchronously, after the transactions in flight
+    sc16is750.flush();
+    std::vector<uint8_t> tx = sim.takeTransmitted();
+    sent.insert(sent.end(), tx.begin(), tx.end());
+
+    const CountingSim::Counts &c = sim.counts;
+    printf("%-8s received %zu, sent %zu, overruns %u, submitted %u, refused "
+           "%u, callbacks rxlvl %u rx %u tx %u, drains %u\n",
+           name, received.size(), sent.size(), sim.overruns(), c.submitted,
+           c.refused, c.rxLevel, c.rxData, c.txDone, c.drains);
+
+    bool ok = received == down && sent == up && sim.overruns() == 0;
+    ok &= sim.queued() == 0 && sim.callbacksRun() == c.submitted;
+    ok &= c.rxLevel > 0 && c.rxData > 0 && c.txDone > 0 && c.drains > 0;
+    if (depth)
+        ok &= c.refused > 0;
+    return ok;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    bool ok = stream("queue", 0);
+    ok &= stream("depth 1", 1);
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file sim_baud.cpp
+ * @brief Baudrate planning against the simulated device
+ * @details The plans of a fixed configuration are checked at compile time.
+ * At run time the simulated device must run at the baudrate reported by
+ * getBaudPlan(), and a baudrate off by more than the tolerance must be
+ * rejected, leaving the previous one. Prints the divisor table of a few
+ * crystals.
+ */
+#include <Arduino.h>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t CPU_CRYSTAL_FREQ = 16000000;
+
+static_assert(SC16IS7X0_BaudPlan::worstPpm(CRYSTAL_FREQ) == 0,
+              "14.7456 MHz reaches the standard baudrates exactly");
+static_assert(SC16IS7X0_BaudPlan::make(CPU_CRYSTAL_FREQ, 9600).within(2000),
+              "9600 baud within 0.2 % from 16 MHz");
+static_assert(!SC16IS7X0_BaudPlan::make(CPU_CRYSTAL_FREQ, 115200).within(
+                  SC16IS7X0_BAUD_TOLERANCE_PPM),
+              "115200 baud is 3.5 % off from 16 MHz");
+static_assert(!SC16IS7X0_BaudPlan::make(CRYSTAL_FREQ, 3).valid(),
+              "3 baud needs a divisor above 0xFFFF with both prescalers");
+
+static void table(uint32_t xtalFreq)
+{
+    printf("%u Hz, worst %u ppm\n", xtalFreq,
+           SC16IS7X0_BaudPlan::worstPpm(xtalFreq));
+    for (uint32_t baud : SC16IS7X0_BaudPlan::standard) {
+        SC16IS7X0_BaudPlan plan = SC16IS7X0_BaudPlan::make(xtalFreq, baud);
+        if (plan.valid())
+            printf("  %7u: divisor %5u /%u, %7u baud, %+7d ppm\n", baud,
+                   plan.divisor, plan.prescaler, plan.baudrate,
+                   (int)plan.errorPpm);
+        else
+            printf("  %7u: out of range\n", baud);
+    }
+}
+
+static bool program(uint32_t xtalFreq)
+{
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(xtalFreq, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    SC16IS7X0 sc16is750(xtalFreq);
+    sc16is750.begin(sim);
+
+    bool ok = sc16is750.begin_UART(9600);
+    double first = sim->baudrate();
+    ok &= (uint32_t)(first + 0.5) == sc16is750.getBaudPlan().baudrate;
+
+    // 3.5 % off from 16 MHz, exact from 14.7456 MHz
+    bool accepted = sc16is750.updateBaudRate(115200);
+    double second = sim->baudrate();
+    bool relaxed = accepted || sc16is750.updateBaudRate(115200, 40000);
+    double third = sim->baudrate();
+
+    printf("%u Hz: 9600 -> %.1f baud, 115200 %s (%.1f baud), %.1f baud with "
+           "4 %% tolerance\n",
+           xtalFreq, first, accepted ? "accepted" : "rejected", second,
+           third);
+    ok &= accepted == (xtalFreq == CRYSTAL_FREQ);
+    ok &= accepted ? second == 115200 : second == first;
+    ok &= relaxed &&
+          (uint32_t)(third + 0.5) == sc16is750.getBaudPlan().baudrate;
+    return ok;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    table(CRYSTAL_FREQ);
+    table(CPU_CRYSTAL_FREQ);
+
+    bool ok = program(CRYSTAL_FREQ);
+    ok &= program(CPU_CRYSTAL_FREQ);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file sim_flow.cpp
+ * @brief RTS levels against the simulated device
+ * @details The remote streams at 115200 baud faster than the application
+ * consumes, hardware RTS holds it back. It keeps sending 6 characters after
+ * RTS goes inactive. The default levels (halt at 40) must not overrun, a halt
+ * level of 60 must, and enableAutoFlowControlLevels() must find a level above
+ * 40 without overrun. A remote first slow to stop (12 characters) overruns
+ * the FIFO once and lowers the tuned level, which must rise again without
+ * overrun once it stops after 6. Runs on the virtual clock.
+ */
+#include <Arduino.h>
+
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t UART_BAUD = 115200;
+constexpr size_t PAYLOAD = 2048;
+constexpr uint8_t SKID = 6;
+constexpr uint8_t SLOW_SKID = 12;
+constexpr uint32_t LOOP_US = 50;
+constexpr uint32_t CONSUME_US = 10000; // 64 bytes every 10 ms, 6400 bytes/s
+constexpr size_t CONSUME = 64;
+
+enum Levels { DEFAULT_LEVELS, HIGH_LEVELS, AUTO_LEVELS, AUTO_RECOVER };
+
+struct Result
+{
+    bool complete;
+    uint32_t overruns;
+    uint8_t halt;
+    // AUTO_RECOVER, when the remote gets quicker
+    uint8_t slowHalt;
+    uint32_t slowOverruns;
+    uint8_t highWater;
+};
+
+static Result stream(Levels levels, const char *name)
+{
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    sim->setRtsSkid(levels == AUTO_RECOVER ? SLOW_SKID : SKID);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(UART_BAUD);
+    sc16is750.enableHardwareRTS();
+    if (levels == HIGH_LEVELS)
+        sc16is750.setFlowControlLevels(60, 52);
+    else if (levels == AUTO_LEVELS || levels == AUTO_RECOVER)
+        sc16is750.enableAutoFlowControlLevels();
+    sc16is750.resetStats();
+
+    std::vector<uint8_t> data(PAYLOAD);
+    for (size_t i = 0; i < PAYLOAD; i++)
+        data[i] = (uint8_t)i;
+    sim->inject(data.data(), data.size());
+
+    size_t received = 0;
+    bool inOrder = true;
+    uint32_t start = millis();
+    uint32_t consumed = micros();
+    uint8_t slowHalt = 0;
+    uint32_t slowOverruns = 0;
+    while (received < PAYLOAD && millis() - start < 1000) {
+        sc16is750.service();
+        if (micros() - consumed >= CONSUME_US) {
+            consumed = micros();
+            for (size_t i = 0; i < CONSUME && sc16is750.available(); i++) {
+                inOrder &= sc16is750.read() == (uint8_t)received;
+                received++;
+            }
+            if (levels == AUTO_RECOVER && !slowHalt &&
+                received >= PAYLOAD / 2) {
+                slowHalt = sc16is750.getRtsHaltLevel();
+                slowOverruns = sim->overruns();
+                sim->setRtsSkid(SKID);
+            }
+        }
+        delayMicroseconds(LOOP_US);
+    }
+
+    const SC16IS7X0::Stats &s = sc16is750.stats();
+    Result r = {received == PAYLOAD && inOrder, sim->overruns(),
+                sc16is750.getRtsHaltLevel(), slowHalt, slowOverruns,
+                s.rxHighWater};
+    printf("%-8s rx %u/%u, halt %u, resume %u, high water %u, "
+           "overruns %u\n",
+           name, (unsigned)received, (unsigned)PAYLOAD, r.halt,
+           sc16is750.getRtsResumeLevel(), r.highWater, r.overruns);
+    return r;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    Result base = stream(DEFAULT_LEVELS, "40/8");
+    Result high = stream(HIGH_LEVELS, "60/52");
+    Result tuned = stream(AUTO_LEVELS, "auto");
+    Result recover = stream(AUTO_RECOVER, "recover");
+    printf("recover  halt %u, overruns %u with a slow remote\n",
+           recover.slowHalt, recover.slowOverruns);
+
+    bool ok = base.complete && base.overruns == 0;
+    ok &= high.overruns > 0;
+    ok &= tuned.complete && tuned.overruns == 0 && tuned.halt > base.halt &&
+          tuned.highWater > base.highWater;
+    ok &= recover.overruns == recover.slowOverruns &&
+          recover.halt > recover.slowHalt;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
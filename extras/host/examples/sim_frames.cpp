@@ -0,0 +1,95 @@
+/**
+ * @file sim_frames.cpp
+ * @brief Delimiter-framed reads against the simulated device
+ * @details Lines are received at 115200 baud in interrupt mode with an RX
+ * trigger level of 60. With enableFrameDelimiter('\n'), readFrame() must
+ * return each line exactly, one interrupt per line, and sooner than the RX
+ * time-out interrupt delivers it without the delimiter. Runs on the virtual
+ * clock.
+ */
+#include <Arduino.h>
+
+#include <string>
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t UART_BAUD = 115200;
+constexpr uint8_t IRQ_PIN = 4;
+constexpr uint32_t LOOP_US = 20;
+constexpr uint32_t GAP_US = 5000;
+
+static const char *lines[] = {"hello\n", "a longer line of text\n", "x\n",
+                              "$GPGGA,123519,4807.038,N,01131.000,E*47\n"};
+
+struct Result
+{
+    bool exact;
+    uint32_t interrupts;
+    uint32_t worstUs; // From the delimiter stop bit to the frame returned
+};
+
+static Result receive(bool delimiter, const char *name)
+{
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(UART_BAUD);
+    sc16is750.setTriggerLevels(60, 8);
+    if (delimiter)
+        sc16is750.enableFrameDelimiter('\n');
+    sim->attachIrqPin(IRQ_PIN);
+    sc16is750.enableInterrupt(IRQ_PIN);
+    sc16is750.handleInterrupt();
+    sc16is750.resetStats();
+
+    Result r = {true, 0, 0};
+    for (const char *line : lines) {
+        uint32_t arrival =
+            micros() + strlen(line) * sc16is750.getCharTimeNs() / 1000;
+        sim->inject(line);
+
+        std::string frame;
+        uint32_t start = micros();
+        while ((frame.empty() || frame.back() != '\n') &&
+               micros() - start < GAP_US) {
+            if (delimiter) {
+                uint8_t buffer[64];
+                size_t n = sc16is750.readFrame(buffer, sizeof(buffer));
+                frame.append((const char *)buffer, n);
+            } else {
+                while (sc16is750.available())
+                    frame += (char)sc16is750.read();
+            }
+            delayMicroseconds(LOOP_US);
+        }
+
+        r.exact &= frame == line;
+        uint32_t latency = micros() - arrival;
+        if (latency > r.worstUs)
+            r.worstUs = latency;
+        delayMicroseconds(GAP_US);
+    }
+
+    r.interrupts = sc16is750.stats().interrupts;
+    printf("%-10s exact %s, interrupts %u, worst latency %u us\n", name,
+           r.exact ? "yes" : "no", r.interrupts, r.worstUs);
+    return r;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    Result timeout = receive(false, "time-out");
+    Result framed = receive(true, "delimiter");
+
+    size_t count = sizeof(lines) / sizeof(lines[0]);
+    bool ok = timeout.exact && framed.exact && framed.interrupts == count &&
+              framed.worstUs < timeout.worstUs;
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/**
+ * @file sim_gpio.cpp
+ * @brief Port-wide GPIO against the simulated device
+ * @details A scan loop reads 8 inputs per cycle. With digitalRead() each pin
+ * costs a bus transaction. With readPort() in interrupt mode and the inputs
+ * in IOINTENA, the steady state costs none, and every input change must reach
+ * the pin change callbacks and readPort(). writePort() must set several
+ * outputs in one write. Runs on the virtual clock.
+ */
+#include <Arduino.h>
+
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t UART_BAUD = 115200;
+constexpr uint8_t IRQ_PIN = 4;
+constexpr int CYCLES = 1000;
+constexpr uint32_t CYCLE_US = 100;
+
+struct Change
+{
+    uint8_t pin;
+    int val;
+};
+
+static void onChange(void *arg, uint8_t pin, int val)
+{
+    static_cast<std::vector<Change> *>(arg)->push_back({pin, val});
+}
+
+static SC16IS7X0_Sim *attach(SC16IS7X0 &uart)
+{
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    uart.begin(sim);
+    uart.begin_UART(UART_BAUD);
+    uart.setPortDirection(0x00);
+    return sim;
+}
+
+// Input levels of the scan: one pin toggles every 100 cycles
+static uint8_t levels(int cycle)
+{
+    uint8_t value = 0xA5;
+    for (int i = 0; i < cycle / 100; i++)
+        value ^= 0x01 << (i % 8);
+    return value;
+}
+
+static bool perPin(void)
+{
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    SC16IS7X0_Sim *sim = attach(sc16is750);
+    sc16is750.resetStats();
+
+    bool exact = true;
+    for (int cycle = 0; cycle < CYCLES; cycle++) {
+        sim->setInputPins(levels(cycle));
+        uint8_t value = 0;
+        for (uint8_t pin = 0; pin < 8; pin++)
+            value |= sc16is750.digitalRead(pin) << pin;
+        exact &= value == levels(cycle);
+        delayMicroseconds(CYCLE_US);
+    }
+
+    uint32_t transactions = sc16is750.stats().transactions;
+    printf("digitalRead %.1f transactions per scan, exact %s\n",
+           (double)transactions / CYCLES, exact ? "yes" : "no");
+    return exact && transactions == 8 * CYCLES;
+}
+
+static bool cached(void)
+{
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    SC16IS7X0_Sim *sim = attach(sc16is750);
+    sim->attachIrqPin(IRQ_PIN);
+    sc16is750.enableInterrupt(IRQ_PIN);
+    sim->setInputPins(levels(0));
+
+    std::vector<Change> changes;
+    for (uint8_t pin = 0; pin < 8; pin++)
+        sc16is750.attachPinChange(pin, onChange, &changes);
+    sc16is750.service();
+    sc16is750.resetStats();
+
+    bool exact = true;
+    uint32_t steady = 0;
+    for (int cycle = 0; cycle < CYCLES; cycle++) {
+        bool edge = levels(cycle) != levels(cycle ? cycle - 1 : 0);
+        sim->setInputPins(levels(cycle));
+        uint32_t before = sc16is750.stats().transactions;
+        sc16is750.service();
+        exact &= sc16is750.readPort() == levels(cycle);
+        if (!edge)
+            steady += sc16is750.stats().transactions - before;
+        delayMicroseconds(CYCLE_US);
+    }
+
+    // One callback per toggle, with the new level
+    bool called = changes.size() == (CYCLES - 1) / 100;
+    for (size_t i = 0; called && i < changes.size(); i++) {
+        uint8_t pin = i % 8;
+        int val = levels((i + 1) * 100) >> pin & 0x01;
+        called = changes[i].pin == pin && changes[i].val == val;
+    }
+
+    printf("readPort    %u transactions in steady state, %u for %u changes, "
+           "exact %s, callbacks %s\n",
+           steady, sc16is750.stats().transactions - steady,
+           (unsigned)changes.size(), exact ? "yes" : "no",
+           called ? "yes" : "no");
+    return exact && called && steady == 0;
+}
+
+static bool outputs(void)
+{
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    SC16IS7X0_Sim *sim = attach(sc16is750);
+    sc16is750.setPortDirection(0xF0);
+    sc16is750.writePort(0xF0, 0x00);
+    sc16is750.resetStats();
+
+    sc16is750.writePort(0x50, 0xFF);
+    sc16is750.writePort(0x30, 0x20);
+    uint32_t transactions = sc16is750.stats().transactions;
+
+    printf("writePort   outputs 0x%02X, %u transactions\n", sim->outputPins(),
+           transactions);
+    return sim->outputPins() == 0x60 && transactions == 2;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    bool ok = perPin();
+    ok &= cached();
+    ok &= outputs();
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
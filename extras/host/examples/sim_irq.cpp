@@ -0,0 +1,115 @@
+/**
+ * @file sim_irq.cpp
+ * @brief Interrupt mode service against the simulated device
+ * @details The IRQ output of the simulated chip is left unconnected, so that
+ * every edge is missed: the application sleeps until nextServiceDeadline()
+ * and calls service(). The data received and the data written must still
+ * get through, by the SC16IS7X0_POLL_IDLE_US safety net, with a handful of
+ * wake-ups.
+ *
+ * 2048 bytes are then received at 921600 baud over I2C at 1 MHz, read byte
+ * per byte with available() and read(): the bus can barely carry the line
+ * rate, the RX FIFO must not overrun. Runs on the virtual clock.
+ */
+#include <Arduino.h>
+
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t UART_BAUD = 115200;
+constexpr uint8_t IRQ_PIN = 4;
+constexpr size_t LEN = 40;
+constexpr uint32_t FAST_BAUD = 921600;
+constexpr size_t FAST_LEN = 2048;
+
+static bool missedEdges(void)
+{
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(UART_BAUD);
+    // Nothing drives the pin
+    sc16is750.enableInterrupt(IRQ_PIN);
+    sc16is750.service();
+
+    std::vector<uint8_t> down(LEN), up(LEN);
+    for (size_t i = 0; i < LEN; i++) {
+        down[i] = (uint8_t)(i * 3 + 1);
+        up[i] = (uint8_t)(i * 5 + 2);
+    }
+    sim->inject(down.data(), down.size());
+    sc16is750.write(up.data(), up.size());
+
+    std::vector<uint8_t> received, sent;
+    uint32_t wakeups = 0, start = micros();
+    while ((received.size() < LEN || sent.size() < LEN) &&
+           micros() - start < 3 * SC16IS7X0_POLL_IDLE_US) {
+        int32_t us = (int32_t)(sc16is750.nextServiceDeadline() - micros());
+        delayMicroseconds(us > 0 ? us : 1);
+        sc16is750.service();
+        wakeups++;
+
+        while (sc16is750.available())
+            received.push_back((uint8_t)sc16is750.read());
+        std::vector<uint8_t> tx = sim->takeTransmitted();
+        sent.insert(sent.end(), tx.begin(), tx.end());
+    }
+    uint32_t elapsed = micros() - start;
+
+    printf("missed   received %zu, sent %zu in %u us, %u wake-ups\n",
+           received.size(), sent.size(), elapsed, wakeups);
+    return received == down && sent == up &&
+           elapsed <= SC16IS7X0_POLL_IDLE_US + 1000 && wakeups <= 4;
+}
+
+static bool fastRx(void)
+{
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::I2C_BUS, 1000000);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(FAST_BAUD);
+    sim->attachIrqPin(IRQ_PIN);
+    sc16is750.enableInterrupt(IRQ_PIN);
+
+    std::vector<uint8_t> down(FAST_LEN);
+    for (size_t i = 0; i < FAST_LEN; i++)
+        down[i] = (uint8_t)(i * 7 + 3);
+    sim->inject(down.data(), down.size());
+
+    std::vector<uint8_t> received;
+    uint32_t start = micros();
+    uint32_t charUs = sc16is750.getCharTimeNs() / 1000 + 1;
+    while (received.size() < FAST_LEN &&
+           micros() - start < 2 * FAST_LEN * charUs) {
+        size_t n = 0;
+        while (sc16is750.available()) {
+            received.push_back((uint8_t)sc16is750.read());
+            n++;
+        }
+        if (n == 0)
+            delayMicroseconds(charUs);
+    }
+
+    const SC16IS7X0::Stats &s = sc16is750.stats();
+    printf("fast rx  received %zu in %u us, overruns %u, interrupts %u, "
+           "transactions %u\n",
+           received.size(), micros() - start, sim->overruns(), s.interrupts,
+           s.transactions);
+    return received == down && sim->overruns() == 0;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    bool ok = missedEdges();
+    ok &= fastRx();
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file sim_loopback.cpp
+ * @brief examples/loopback.cpp on the host, against the simulated device
+ * @details Sends text through the internal loopback (MCR[4]), receives text
+ * injected by a simulated remote device and checks what is shifted out on
+ * TX. Runs on the virtual clock, the output is the same on every run.
+ */
+#include <Arduino.h>
+
+#include <string>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t UART_BAUD = 115200;
+
+static bool readAll(SC16IS7X0 &uart, const std::string &expected)
+{
+    std::string received;
+    uint32_t start = millis();
+    while (received.length() < expected.length() && millis() - start < 100) {
+        while (uart.available())
+            received += (char)uart.read();
+        delay(1);
+    }
+
+    printf("  received \"%s\"\n", received.c_str());
+    return received == expected;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(UART_BAUD);
+    printf("baudrate %.1f\n", sim->baudrate());
+
+    bool ok = true;
+
+    printf("internal loopback\n");
+    sc16is750.enableLoopback();
+    sc16is750.print("loop 0\n");
+    ok &= readAll(sc16is750, "loop 0\n");
+    sc16is750.disableLoopback();
+
+    printf("remote device\n");
+    sim->inject("hello from the remote side\n");
+    ok &= readAll(sc16is750, "hello from the remote side\n");
+
+    printf("transmission\n");
+    sc16is750.print("hello remote\n");
+    sc16is750.flush();
+    std::vector<uint8_t> tx = sim->takeTransmitted();
+    ok &= std::string(tx.begin(), tx.end()) == "hello remote\n";
+
+    printf("overruns %u, bus time %llu us, virtual time %llu us\n",
+           sim->overruns(), (unsigned long long)sim->busTimeUs(),
+           (unsigned long long)HostArduino::nowMicros());
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file sim_manager.cpp
+ * @brief Two devices on one wired-OR IRQ line, served by SC16IS7X0_Manager
+ * @details Both simulated chips pull the same pin low. The application only
+ * waits for SC16IS7X0_Manager::nextServiceDeadline() or an edge and calls
+ * SC16IS7X0_Manager::service(), with each policy:
+ * - port A receives a frame with enableFrameGap(2000): the RX time-out
+ *   interrupt comes before the gap has passed, nothing asserts the line
+ *   afterwards. The manager must serve the port at its deadline, so that
+ *   readFrame() finds the frame closed, without a bus transaction.
+ * - port B sits on an asynchronous bus, with a TX trigger level of 60: the
+ *   bursts write() submits complete while no THR interrupt comes. The
+ *   manager must serve the port while they are in flight, so that their
+ *   callbacks run from SC16IS7X0_BusIo::poll().
+ * Runs on the virtual clock.
+ */
+#include <Arduino.h>
+
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Manager.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t SPI_FREQ = 4000000;
+constexpr uint32_t UART_BAUD = 115200;
+constexpr uint8_t IRQ_PIN = 4;
+constexpr uint32_t GAP_US = 2000;
+constexpr size_t TX_LEN = 100;
+constexpr size_t TX_CHUNK = 16;
+constexpr uint32_t STEP_US = 10;
+constexpr uint32_t RUN_US = 20000;
+// A burst of a full FIFO on the bus, then the next step
+constexpr uint32_t MAX_FLIGHT_US =
+    (SC16IS7X0_FIFO_SIZE + 1) * 8 * 1000000ULL / SPI_FREQ + 2 * STEP_US;
+
+static const char frame[] = "$GPGGA,123519,4807.038,N*47";
+
+static bool shared(SC16IS7X0_Manager::Policy policy, const char *name)
+{
+    SC16IS7X0_Sim simA(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, SPI_FREQ);
+    SC16IS7X0_Sim simB(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, SPI_FREQ);
+    simB.setAsync(true);
+    simA.attachIrqPin(IRQ_PIN);
+    simB.attachIrqPin(IRQ_PIN);
+
+    SC16IS7X0 portA(CRYSTAL_FREQ), portB(CRYSTAL_FREQ);
+    portA.begin(simA);
+    portA.begin_UART(UART_BAUD);
+    portA.enableFrameGap(GAP_US);
+    portB.begin(simB);
+    portB.begin_UART(UART_BAUD);
+    portB.setTriggerLevels(8, 60);
+
+    SC16IS7X0_Manager manager(policy);
+    manager.add(&portA);
+    manager.add(&portB);
+    manager.enableInterrupt(IRQ_PIN);
+    manager.service();
+
+    std::vector<uint8_t> up(TX_LEN);
+    for (size_t i = 0; i < TX_LEN; i++)
+        up[i] = (uint8_t)(i * 5 + 2);
+    simA.inject(frame);
+
+    std::vector<uint8_t> sent;
+    size_t written = 0;
+    uint32_t wakeups = 0, flightUs = 0, maxFlightUs = 0, start = micros();
+    while (micros() - start < RUN_US) {
+        // Until a deadline passes or an edge comes, like a task waiting for
+        // a notification from the interrupt handler
+        do {
+            delayMicroseconds(STEP_US);
+            flightUs = simB.queued() ? flightUs + STEP_US : 0;
+            if (flightUs > maxFlightUs)
+                maxFlightUs = flightUs;
+        } while ((int32_t)(manager.nextServiceDeadline() - micros()) > 0 &&
+                 micros() - start < RUN_US);
+        manager.service();
+        wakeups++;
+
+        if (written < TX_LEN) {
+            size_t n = TX_LEN - written;
+            written += portB.write(up.data() + written,
+                                   n < TX_CHUNK ? n : TX_CHUNK);
+        }
+        std::vector<uint8_t> tx = simB.takeTransmitted();
+        sent.insert(sent.end(), tx.begin(), tx.end());
+    }
+
+    // Closed by the manager, readFrame() has no bus transaction to do
+    size_t len = strlen(frame);
+    uint32_t transactions = portA.stats().transactions;
+    uint8_t buffer[64];
+    size_t n = portA.readFrame(buffer, sizeof(buffer));
+    bool exact = n == len && memcmp(buffer, frame, len) == 0;
+    bool closed = portA.stats().transactions == transactions;
+
+    printf("%-8s frame %s, %s; sent %zu/%zu, longest flight %u us; "
+           "wake-ups %u, services %u + %u\n",
+           name, exact ? "exact" : "wrong", closed ? "closed" : "open",
+           sent.size(), TX_LEN, maxFlightUs, wakeups,
+           manager.stats(0).services, manager.stats(1).services);
+    return exact && closed && sent == up && simB.queued() == 0 &&
+           maxFlightUs <= MAX_FLIGHT_US && wakeups < 100;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    bool ok = shared(SC16IS7X0_Manager::ROUND_ROBIN, "rr");
+    ok &= shared(SC16IS7X0_Manager::EARLIEST_DEADLINE, "edf");
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
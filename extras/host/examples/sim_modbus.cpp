@@ -0,0 +1,103 @@
+/**
+ * @file sim_modbus.cpp
+ * @brief Frames delimited by silence (Modbus RTU) against the simulated device
+ * @details Frames of 8, 120 and 5 bytes separated by 5 character times of
+ * silence are received at 9600 baud 8E1, polled and in interrupt mode, with
+ * enableFrameGap(). readFrame() must return them exactly, with the time of
+ * their last character and within a few character times after the gap.
+ * Runs on the virtual clock.
+ */
+#include <Arduino.h>
+
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t UART_BAUD = 9600;
+constexpr uint8_t IRQ_PIN = 4;
+constexpr uint32_t LOOP_US = 100;
+constexpr int GAP_CHARS = 5;
+
+static const size_t sizes[] = {8, 120, 5};
+constexpr size_t FRAMES = sizeof(sizes) / sizeof(sizes[0]);
+
+static bool receive(bool irq, const char *name)
+{
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(UART_BAUD, SERIAL_8E1);
+    sc16is750.enableFrameGap();
+    if (irq) {
+        sim->attachIrqPin(IRQ_PIN);
+        sc16is750.enableInterrupt(IRQ_PIN);
+    }
+
+    uint32_t charNs = sc16is750.getCharTimeNs();
+    uint32_t gap = sc16is750.getFrameGapUs();
+
+    // Frames injected one after the other, GAP_CHARS character times apart
+    std::vector<std::vector<uint8_t>> sent;
+    std::vector<uint32_t> ends;
+    uint64_t at = micros();
+    for (size_t f = 0; f < FRAMES; f++) {
+        std::vector<uint8_t> frame(sizes[f]);
+        for (size_t i = 0; i < frame.size(); i++)
+            frame[i] = (uint8_t)(f * 16 + i);
+        sent.push_back(frame);
+        at += (uint64_t)frame.size() * charNs / 1000;
+        ends.push_back((uint32_t)at);
+        at += (uint64_t)GAP_CHARS * charNs / 1000;
+    }
+
+    size_t injected = 0, next = 0;
+    bool exact = true;
+    uint32_t start = micros(), worstEnd = 0, worstLatency = 0;
+    while (next < FRAMES && micros() - start < 1000000) {
+        // Each frame is injected at its start time
+        if (injected < FRAMES &&
+            micros() >= ends[injected] - sizes[injected] * charNs / 1000) {
+            sim->inject(sent[injected].data(), sent[injected].size());
+            injected++;
+        }
+
+        sc16is750.service();
+        uint8_t buffer[256];
+        uint32_t end = 0;
+        size_t n = sc16is750.readFrame(buffer, sizeof(buffer), &end);
+        if (n) {
+            exact &= std::vector<uint8_t>(buffer, buffer + n) == sent[next];
+            uint32_t error = end > ends[next] ? end - ends[next] : ends[next] - end;
+            if (error > worstEnd)
+                worstEnd = error;
+            if (micros() - ends[next] > worstLatency)
+                worstLatency = micros() - ends[next];
+            next++;
+        }
+        delayMicroseconds(LOOP_US);
+    }
+
+    const SC16IS7X0::Stats &s = sc16is750.stats();
+    printf("%-5s %u/%u frames, exact %s, gap %u us, end time error %u us, "
+           "worst latency %u us, transactions %u\n",
+           name, (unsigned)next, (unsigned)FRAMES, exact ? "yes" : "no", gap,
+           worstEnd, worstLatency, s.transactions);
+
+    // Dated within 2 character times, delivered within the gap plus 3
+    uint32_t charUs = charNs / 1000;
+    return next == FRAMES && exact && worstEnd <= 2 * charUs &&
+           worstLatency <= gap + 3 * charUs;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    bool ok = receive(false, "poll");
+    ok &= receive(true, "irq");
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+/**
+ * @file sim_portseq.cpp
+ * @brief GPIO waveforms through IOSTATE bursts against the simulated device
+ * @details writePortSequence() must put every value on the outputs, in
+ * order, one per getPortSamplePeriodNs(), far faster than one writePort()
+ * per value. readPortSequence() must capture an input pattern 4 times slower
+ * than the sample rate, 4 samples per level on SPI, without missing one on
+ * I2C. The period is measured by the first sequence. Runs on the virtual
+ * clock.
+ */
+#include <Arduino.h>
+
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr size_t SAMPLES = 256;
+
+static SC16IS7X0_Sim *attach(SC16IS7X0 &uart, SC16IS7X0_BusIo::ioBus bus,
+                             uint32_t freq, uint8_t outputs)
+{
+    SC16IS7X0_Sim *sim = new SC16IS7X0_Sim(CRYSTAL_FREQ, bus, freq);
+    uart.begin(sim);
+    uart.begin_UART(115200);
+    uart.setPortDirection(outputs);
+    return sim;
+}
+
+static bool stream(void)
+{
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    SC16IS7X0_Sim *sim = attach(sc16is750, SC16IS7X0_BusIo::SPI_BUS, 4000000,
+                                0xFF);
+
+    // Clock and data of a shift register: data set, clock high, clock low
+    std::vector<uint8_t> wave;
+    for (size_t i = 0; wave.size() + 3 <= SAMPLES; i++) {
+        uint8_t data = (i >> 1) & 0x02;
+        wave.push_back(data);
+        wave.push_back(data | 0x01);
+        wave.push_back(data);
+    }
+
+    // One transaction per change
+    sim->traceOutputs(true);
+    sc16is750.resetStats();
+    uint32_t start = micros();
+    for (uint8_t value : wave)
+        sc16is750.writePort(0xFF, value);
+    uint32_t perValueUs = micros() - start;
+    uint32_t perValue = sc16is750.stats().transactions;
+    sim->takeOutputTrace();
+
+    sc16is750.resetStats();
+    start = micros();
+    size_t written = sc16is750.writePortSequence(wave.data(), wave.size());
+    uint32_t burstUs = micros() - start;
+    uint32_t burst = sc16is750.stats().transactions;
+    uint32_t estimate = sc16is750.getPortSamplePeriodNs();
+    std::vector<SC16IS7X0_Sim::PinSample> trace = sim->takeOutputTrace();
+
+    bool exact = written == wave.size() && trace.size() == wave.size();
+    uint64_t worst = 0;
+    for (size_t i = 0; exact && i < trace.size(); i++) {
+        exact = trace[i].levels == wave[i];
+        if (i) {
+            uint64_t period = trace[i].ns - trace[i - 1].ns;
+            uint64_t error = period > estimate ? period - estimate
+                                               : estimate - period;
+            if (error > worst)
+                worst = error;
+        }
+    }
+
+    printf("write    %u values, %u transactions / %u us one by one, "
+           "%u / %u us in a burst, period %u ns (error %u ns), exact %s\n",
+           (unsigned)wave.size(), perValue, perValueUs, burst, burstUs,
+           estimate, (unsigned)worst, exact ? "yes" : "no");
+    return exact && burst == 1 && burstUs < perValueUs &&
+           worst * 100 <= estimate;
+}
+
+static bool capture(SC16IS7X0_BusIo::ioBus bus, uint32_t freq,
+                    const char *name)
+{
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    SC16IS7X0_Sim *sim = attach(sc16is750, bus, freq, 0x00);
+    std::vector<uint8_t> samples(SAMPLES);
+    uint32_t before = sc16is750.getPortSamplePeriodNs();
+    sc16is750.readPortSequence(samples.data(), samples.size());
+    uint32_t period = sc16is750.getPortSamplePeriodNs();
+
+    // 4 samples per level, the pattern starts with the first sample
+    std::vector<uint8_t> pattern(SAMPLES / 4);
+    for (size_t i = 0; i < pattern.size(); i++)
+        pattern[i] = (uint8_t)(i * 37);
+    sim->setInputPattern(pattern, 4 * period);
+    size_t read = sc16is750.readPortSequence(samples.data(), samples.size());
+
+    // Runs of equal samples, in the order of the pattern. The first and the
+    // last ones are cut by the start and the end of the sequence.
+    std::vector<uint8_t> levels;
+    size_t shortest = SAMPLES, longest = 0, run = 0;
+    for (size_t i = 0; i < read; i++) {
+        run++;
+        if (i + 1 == read || samples[i + 1] != samples[i]) {
+            if (!levels.empty() && i + 1 < read && run < shortest)
+                shortest = run;
+            levels.push_back(samples[i]);
+            if (run > longest)
+                longest = run;
+            run = 0;
+        }
+    }
+    bool exact = read == SAMPLES && levels.size() >= pattern.size() - 2 &&
+                 std::equal(levels.begin(), levels.end(), pattern.begin());
+
+    printf("%-8s %u samples, period %u ns (%u before measuring), %u to %u "
+           "samples per level, exact %s\n",
+           name, (unsigned)read, period, before, (unsigned)shortest,
+           (unsigned)longest, exact ? "yes" : "no");
+    // I2C transactions are split in Wire buffers, the samples are spaced
+    // evenly within one only
+    if (bus == SC16IS7X0_BusIo::SPI_BUS)
+        exact &= shortest >= 3 && longest <= 5;
+    return exact && before == 0 && period;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    bool ok = stream();
+    ok &= capture(SC16IS7X0_BusIo::SPI_BUS, 4000000, "read spi");
+    ok &= capture(SC16IS7X0_BusIo::I2C_BUS, 400000, "read i2c");
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
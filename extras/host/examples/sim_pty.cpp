@@ -0,0 +1,194 @@
+/**
+ * @file sim_pty.cpp
+ * @brief Pseudo-terminal bridge against the simulated device
+ * @details A program opens the slave side of the PTY like a serial device.
+ * 2000 bytes are written to it while the remote sends 2000 bytes, at 115200
+ * baud 8E1: both directions must arrive exactly, at line rate, with no RX
+ * FIFO overrun and a small fraction of a system call per byte. A termios
+ * change to 57600 baud and 2 stop bits must reach the UART, the parity of
+ * open() must stay although the PTY driver clears PARENB, a speed the crystal
+ * cannot reach must be rejected and written back. IXON must program the
+ * receiver to obey XON1 / XOFF1, IXOFF the transmitter to send them
+ * (EFR[3:0]). The UART runs on the virtual clock, the bridge steps without
+ * waiting.
+ */
+#include <Arduino.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_PtyBridge.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t UART_BAUD = 115200;
+constexpr size_t LEN = 2000;
+
+// Until the other side of the PTY has caught up, in real time
+static void settle(int fd, short events)
+{
+    struct pollfd p = {fd, events, 0};
+    poll(&p, 1, 100);
+}
+
+static void step(SC16IS7X0_PtyBridge &bridge, SC16IS7X0 &uart)
+{
+    bridge.step(0);
+    int32_t us = (int32_t)(uart.nextServiceDeadline() - micros());
+    delayMicroseconds(us > 0 ? us : 1);
+}
+
+static bool stream(SC16IS7X0_Sim &sim, SC16IS7X0 &uart,
+                   SC16IS7X0_PtyBridge &bridge, int tty)
+{
+    std::vector<uint8_t> up(LEN), down(LEN);
+    for (size_t i = 0; i < LEN; i++) {
+        up[i] = (uint8_t)(i * 7);
+        down[i] = (uint8_t)(i * 13 + 1);
+    }
+
+    bridge.resetStats();
+    uart.resetStats();
+    sim.inject(down.data(), down.size());
+
+    std::vector<uint8_t> sent, received;
+    size_t written = 0;
+    uint32_t start = micros(), txUs = 0, rxUs = 0;
+    while ((sent.size() < LEN || received.size() < LEN) &&
+           micros() - start < 1000000) {
+        if (written < LEN) {
+            ssize_t n = write(tty, up.data() + written, LEN - written);
+            if (n > 0)
+                written += (size_t)n;
+        }
+        // Data on its way through the PTY is waited for
+        if (written > bridge.stats().fromPty && uart.availableForWrite() > 0)
+            settle(bridge.fd(), POLLIN);
+        step(bridge, uart);
+
+        if (received.size() < bridge.stats().toPty)
+            settle(tty, POLLIN);
+        uint8_t buffer[SC16IS7X0_PTY_BUFFER_SIZE];
+        ssize_t n = read(tty, buffer, sizeof(buffer));
+        if (n > 0)
+            received.insert(received.end(), buffer, buffer + n);
+
+        std::vector<uint8_t> tx = sim.takeTransmitted();
+        sent.insert(sent.end(), tx.begin(), tx.end());
+        if (!txUs && sent.size() == LEN)
+            txUs = micros() - start;
+        if (!rxUs && received.size() == LEN)
+            rxUs = micros() - start;
+    }
+
+    const SC16IS7X0_PtyBridge::Stats &s = bridge.stats();
+    uint32_t lineUs = (uint32_t)(LEN * uart.getCharTimeNs() / 1000);
+    double perByte = (double)s.syscalls / (double)(s.toPty + s.fromPty);
+    printf("stream   line %u us, sent in %u us, received in %u us, overruns "
+           "%u, wake-ups %u, syscalls %u (%.3f per byte)\n",
+           lineUs, txUs, rxUs, sim.overruns(), s.wakeups, s.syscalls, perByte);
+
+    // Received at line rate if the RX FIFO never overran
+    return sent == up && received == down && sim.overruns() == 0 &&
+           txUs <= lineUs + lineUs / 50 && perByte < 0.25;
+}
+
+static bool reconfigure(SC16IS7X0_Sim &sim, SC16IS7X0 &uart,
+                        SC16IS7X0_PtyBridge &bridge, int tty)
+{
+    struct termios tio;
+    tcgetattr(tty, &tio);
+    cfsetspeed(&tio, B57600);
+    tio.c_cflag |= CSTOPB;
+    tcsetattr(tty, TCSADRAIN, &tio);
+
+    // 'C' has three bits set, even parity sets the 9th. Start, 8 data bits,
+    // parity and 2 stop bits at 57600 baud.
+    uint32_t charNs = (uint32_t)(12 * 1000000000ULL / 57600);
+    write(tty, "C", 1);
+    settle(bridge.fd(), POLLIN);
+    std::vector<uint16_t> sent;
+    for (int i = 0; i < 100 && sent.empty(); i++) {
+        step(bridge, uart);
+        sent = sim.takeTransmitted9();
+    }
+    bool format = sent == std::vector<uint16_t>{0x100 | 'C'};
+    format &= uart.getCharTimeNs() == charNs;
+
+    // 4 Mbaud is out of reach of 14.7456 MHz, 57600 stays
+    cfsetspeed(&tio, B4000000);
+    tcsetattr(tty, TCSANOW, &tio);
+    step(bridge, uart);
+    tcgetattr(tty, &tio);
+    bool kept = cfgetospeed(&tio) == B57600;
+
+    const SC16IS7X0_PtyBridge::Stats &s = bridge.stats();
+    printf("termios  %.0f baud, parity bit %s, 4000000 rejected %u, written "
+           "back %s\n",
+           sim.baudrate(), format ? "set" : "wrong", s.rejected,
+           kept ? "yes" : "no");
+    return format && (uint32_t)(sim.baudrate() + 0.5) == 57600 &&
+           s.rejected == 1 && kept && s.reconfigs == 2;
+}
+
+static bool flowControl(SC16IS7X0_Sim &sim, SC16IS7X0 &uart,
+                        SC16IS7X0_PtyBridge &bridge, int tty)
+{
+    // IXON obeys the XOFF received, IXOFF sends XOFF
+    static const struct {
+        tcflag_t iflag;
+        uint8_t efr;
+    } cases[] = {
+        {IXON, SC16IS7X0_SWFLOW_RX_XON1},
+        {IXOFF, SC16IS7X0_SWFLOW_TX_XON1},
+        {IXON | IXOFF, SC16IS7X0_SWFLOW_RX_XON1 | SC16IS7X0_SWFLOW_TX_XON1},
+        {0, 0},
+    };
+
+    bool ok = true;
+    for (const auto &c : cases) {
+        struct termios tio;
+        tcgetattr(tty, &tio);
+        tio.c_iflag = (tio.c_iflag & ~(IXON | IXOFF)) | c.iflag;
+        tcsetattr(tty, TCSANOW, &tio);
+        step(bridge, uart);
+
+        printf("flow     ixon %s, ixoff %s, EFR[3:0] 0x%X\n",
+               (c.iflag & IXON) ? "on " : "off",
+               (c.iflag & IXOFF) ? "on " : "off", sim.softwareFlowMode());
+        ok &= sim.softwareFlowMode() == c.efr;
+    }
+    return ok;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    SC16IS7X0_Sim sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(UART_BAUD);
+
+    SC16IS7X0_PtyBridge bridge(sc16is750);
+    if (!bridge.open(UART_BAUD, SERIAL_8E1)) {
+        printf("no PTY\nFAIL\n");
+        return 1;
+    }
+
+    // Opened like a serial device by any program
+    int tty = open(bridge.slaveName(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+    bool ok = tty >= 0 && stream(sim, sc16is750, bridge, tty);
+    ok &= tty >= 0 && reconfigure(sim, sc16is750, bridge, tty);
+    ok &= tty >= 0 && flowControl(sim, sc16is750, bridge, tty);
+    if (tty >= 0)
+        close(tty);
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
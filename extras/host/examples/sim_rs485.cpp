@@ -0,0 +1,125 @@
+/**
+ * @file sim_rs485.cpp
+ * @brief RS-485 direction control and 9-bit multidrop against the simulated
+ * device
+ * @details RTS must follow the transmitter and be released when the last stop
+ * bit ends. A node with an address must only receive the frames sent to it.
+ * A master must send addresses with the 9th bit set and receive every frame.
+ * Runs on the virtual clock.
+ */
+#include <Arduino.h>
+
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t UART_BAUD = 115200;
+constexpr uint8_t NODE = 0x21;
+
+static SC16IS7X0_Sim *attach(SC16IS7X0 &uart)
+{
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    uart.begin(sim);
+    uart.begin_UART(UART_BAUD);
+    return sim;
+}
+
+static std::vector<uint8_t> receive(SC16IS7X0 &uart, uint32_t us)
+{
+    std::vector<uint8_t> received;
+    uint32_t start = micros();
+    while (micros() - start < us) {
+        uart.service();
+        while (uart.available())
+            received.push_back((uint8_t)uart.read());
+        delayMicroseconds(50);
+    }
+    return received;
+}
+
+static bool direction(void)
+{
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    SC16IS7X0_Sim *sim = attach(sc16is750);
+    sc16is750.enableRS485();
+
+    bool idleLow = !sim->rtsHigh();
+    sc16is750.print("0123456789");
+    sc16is750.service();
+    bool txHigh = sim->rtsHigh();
+
+    // Release time against the end of the last stop bit, sampled every us
+    size_t sent = 0;
+    uint32_t start = micros(), done = 0, released = 0;
+    while ((!done || !released) && micros() - start < 5000) {
+        sc16is750.service();
+        sent += sim->takeTransmitted().size();
+        if (!done && sent == 10)
+            done = micros();
+        if (!released && !sim->rtsHigh())
+            released = micros();
+        delayMicroseconds(1);
+    }
+
+    printf("rs485    idle %s, tx %s, released %d us after the last stop "
+           "bit\n",
+           idleLow ? "low" : "high", txHigh ? "high" : "low",
+           (int)(released - done));
+    return idleLow && txHigh && done && released == done;
+}
+
+static bool node(void)
+{
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    SC16IS7X0_Sim *sim = attach(sc16is750);
+    sc16is750.enableMultidrop(NODE);
+
+    sim->injectAddress(0x20);
+    sim->inject("other");
+    sim->injectAddress(NODE);
+    sim->inject("mine");
+    sim->injectAddress(0x22);
+    sim->inject("nope");
+    std::vector<uint8_t> received = receive(sc16is750, 20000);
+
+    std::vector<uint8_t> expected = {NODE, 'm', 'i', 'n', 'e'};
+    printf("node     %u characters received, parity errors %u\n",
+           (unsigned)received.size(), sc16is750.stats().parityErrors);
+    return received == expected && sc16is750.stats().parityErrors == 0;
+}
+
+static bool master(void)
+{
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    SC16IS7X0_Sim *sim = attach(sc16is750);
+    sc16is750.enableMultidrop();
+
+    sc16is750.writeAddress(NODE);
+    sc16is750.print("hi");
+    sc16is750.flush();
+    std::vector<uint16_t> sent = sim->takeTransmitted9();
+    std::vector<uint16_t> frame = {0x100 | NODE, 'h', 'i'};
+
+    sim->injectAddress(0x30);
+    sim->inject("ok");
+    std::vector<uint8_t> received = receive(sc16is750, 5000);
+    std::vector<uint8_t> reply = {0x30, 'o', 'k'};
+
+    printf("master   %u characters sent, %u received\n", (unsigned)sent.size(),
+           (unsigned)received.size());
+    return sent == frame && received == reply;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    bool ok = direction();
+    ok &= node();
+    ok &= master();
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file sim_static.cpp
+ * @brief Heap-free bus binding
+ * @details begin_SPI(), probeSPIClock() and begin_I2C() must not allocate,
+ * however often a port is re-initialized. A device bound to a simulated bus
+ * with begin(SC16IS7X0_BusIo &) must leave it to its owner: the same bus
+ * serves a second device after the first one has been destroyed. Runs on the
+ * virtual clock.
+ */
+#include <Arduino.h>
+
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr int REINITS = 100;
+
+static size_t allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+static bool reinit(void)
+{
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+
+    size_t before = allocations;
+    bool ok = true;
+    for (int i = 0; i < REINITS; i++) {
+        ok &= sc16is750.begin_SPI(10, &SPI, 4000000);
+        sc16is750.probeSPIClock();
+        ok &= sc16is750.begin_I2C(0x48);
+    }
+    size_t count = allocations - before;
+
+    printf("reinit   %d x begin_SPI() + probeSPIClock() + begin_I2C(), "
+           "%u allocations\n",
+           REINITS, (unsigned)count);
+    return ok && count == 0;
+}
+
+static std::string echo(SC16IS7X0_Sim &sim, const char *text)
+{
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(115200);
+    sc16is750.enableLoopback();
+    sc16is750.print(text);
+    sc16is750.flush();
+
+    std::string received;
+    uint32_t start = micros();
+    while (received.size() < strlen(text) && micros() - start < 10000) {
+        while (sc16is750.available())
+            received += (char)sc16is750.read();
+        delayMicroseconds(100);
+    }
+    return received;
+}
+
+static bool borrowed(void)
+{
+    SC16IS7X0_Sim sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+
+    // The second device finds the bus left by the first one
+    std::string first = echo(sim, "first");
+    std::string second = echo(sim, "second");
+
+    printf("borrowed %s, %s\n", first.c_str(), second.c_str());
+    return first == "first" && second == "second";
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    bool ok = reinit();
+    ok &= borrowed();
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
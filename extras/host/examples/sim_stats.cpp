@@ -0,0 +1,124 @@
+/**
+ * @file sim_stats.cpp
+ * @brief Counters of SC16IS7X0::stats() against the simulated device
+ * @details The bus counters must match SC16IS7X0_BusIoCounter, an RX FIFO
+ * left unread must show up as a full FIFO and an overrun, also when only
+ * flush() reads LSR, and the latency histogram must hold one entry per drain.
+ * Runs on the virtual clock.
+ */
+#include <Arduino.h>
+
+#include <string>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_BusIoCounter.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t UART_BAUD = 115200;
+constexpr uint8_t IRQ_PIN = 4;
+
+static void printStats(const SC16IS7X0::Stats &s)
+{
+    printf("  transactions %u, out %u, in %u, rx %u, tx %u\n", s.transactions,
+           s.bytesOut, s.bytesIn, s.rxBytes, s.txBytes);
+    printf("  overruns %u, rx fifo full %u, high water %u, tx starved %u\n",
+           s.overruns, s.rxFifoFull, s.rxHighWater, s.txStarved);
+    printf("  drains %u, max interval %u us, latency", s.drains,
+           s.maxServiceIntervalUs);
+    for (uint32_t n : s.rxLatency)
+        printf(" %u", n);
+    printf("\n");
+}
+
+static bool sameBus(const SC16IS7X0::Stats &s,
+                    const SC16IS7X0_BusIoCounter::Stats &c)
+{
+    return s.transactions == c.transactions && s.bytesOut == c.bytesOut &&
+           s.bytesIn == c.bytesIn;
+}
+
+static uint32_t histogramTotal(const SC16IS7X0::Stats &s)
+{
+    uint32_t total = 0;
+    for (uint32_t n : s.rxLatency)
+        total += n;
+    return total;
+}
+
+static size_t receive(SC16IS7X0 &uart, size_t expected)
+{
+    size_t received = 0;
+    uint32_t start = millis();
+    while (received < expected && millis() - start < 100) {
+        while (uart.available()) {
+            uart.read();
+            received++;
+        }
+        delayMicroseconds(50);
+    }
+    return received;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    SC16IS7X0_BusIoCounter *counter = new SC16IS7X0_BusIoCounter(sim);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(counter);
+    sc16is750.begin_UART(UART_BAUD);
+    sc16is750.resetStats();
+    counter->reset();
+
+    bool ok = true;
+    std::string text(200, 'x');
+
+    printf("polled traffic\n");
+    sim->inject(text.c_str());
+    ok &= receive(sc16is750, text.length()) == text.length();
+    sc16is750.print(text.c_str());
+    sc16is750.flush();
+    const SC16IS7X0::Stats &s = sc16is750.stats();
+    printStats(s);
+    ok &= sameBus(s, counter->stats());
+    ok &= s.rxBytes == text.length() && s.txBytes == text.length();
+    ok &= s.drains > 0 && histogramTotal(s) == s.drains;
+
+    printf("overrun\n");
+    sim->inject(text.c_str());
+    delay(30);
+    ok &= sc16is750.hasOverrun();
+    receive(sc16is750, SC16IS7X0_FIFO_SIZE);
+    printStats(s);
+    ok &= s.overruns == 1 && s.rxFifoFull == 1 && s.rxHighWater == 64;
+    ok &= sameBus(s, counter->stats());
+
+    printf("overrun seen by flush()\n");
+    sc16is750.resetStats();
+    counter->reset();
+    sim->inject(text.c_str());
+    delay(30);
+    sc16is750.flush();
+    ok &= s.overruns == 1;
+    receive(sc16is750, SC16IS7X0_FIFO_SIZE);
+    printStats(s);
+    ok &= s.overruns == 1 && sameBus(s, counter->stats());
+
+    printf("interrupt\n");
+    sim->attachIrqPin(IRQ_PIN);
+    sc16is750.enableInterrupt(IRQ_PIN);
+    sc16is750.handleInterrupt();
+    sc16is750.resetStats();
+    counter->reset();
+    sim->inject(text.c_str());
+    ok &= receive(sc16is750, text.length()) == text.length();
+    printStats(s);
+    ok &= sameBus(s, counter->stats());
+    ok &= s.overruns == 0 && s.drains > 0 && histogramTotal(s) == s.drains;
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
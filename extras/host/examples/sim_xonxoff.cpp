@@ -0,0 +1,127 @@
+/**
+ * @file sim_xonxoff.cpp
+ * @brief In-chip XON / XOFF flow control against the simulated device
+ * @details TX: an XOFF received must halt the transmitter without reaching
+ * the application and be counted as an XOFF interrupt, the XON must resume
+ * it. RX: the remote streams faster than the application consumes, the chip
+ * must send XOFF / XON by itself so that nothing overruns. Runs on the
+ * virtual clock.
+ */
+#include <Arduino.h>
+
+#include <vector>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+constexpr uint32_t UART_BAUD = 115200;
+constexpr uint8_t IRQ_PIN = 4;
+constexpr uint8_t XON = 0x11;
+constexpr uint8_t XOFF = 0x13;
+constexpr size_t PAYLOAD = 1024;
+constexpr uint32_t LOOP_US = 50;
+constexpr uint32_t CONSUME_US = 10000; // 64 bytes every 10 ms, 6400 bytes/s
+constexpr size_t CONSUME = 64;
+
+static std::vector<uint8_t> pattern(size_t len)
+{
+    // Never XON nor XOFF
+    std::vector<uint8_t> data(len);
+    for (size_t i = 0; i < len; i++)
+        data[i] = (uint8_t)(0x20 + i % 0x5F);
+    return data;
+}
+
+static void run(SC16IS7X0 &uart, uint32_t us)
+{
+    uint32_t start = micros();
+    while (micros() - start < us) {
+        uart.service();
+        delayMicroseconds(LOOP_US);
+    }
+}
+
+static bool transmitHalt(void)
+{
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(UART_BAUD);
+    sc16is750.enableSoftwareFlowControl();
+    sim->attachIrqPin(IRQ_PIN);
+    sc16is750.enableInterrupt(IRQ_PIN);
+
+    std::vector<uint8_t> data = pattern(200);
+    sc16is750.write(data.data(), data.size());
+    run(sc16is750, 20 * 87);
+    sim->inject(&XOFF, 1);
+    run(sc16is750, 2 * 87);
+    size_t before = sim->takeTransmitted().size();
+
+    // At most the character in progress once halted
+    run(sc16is750, 50 * 87);
+    size_t halted = sim->takeTransmitted().size();
+    bool stripped = !sc16is750.available();
+
+    sim->inject(&XON, 1);
+    run(sc16is750, 250 * 87);
+    size_t after = sim->takeTransmitted().size();
+
+    printf("tx       %u before XOFF, %u while halted, %u after XON, "
+           "xoffs %u, stripped %s\n",
+           (unsigned)before, (unsigned)halted, (unsigned)after,
+           sc16is750.stats().xoffs, stripped ? "yes" : "no");
+    return halted <= 1 && before + halted + after == data.size() &&
+           sc16is750.stats().xoffs == 1 && stripped;
+}
+
+static bool receiveBackPressure(void)
+{
+    SC16IS7X0_Sim *sim =
+        new SC16IS7X0_Sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    sim->setRtsSkid(4);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(UART_BAUD);
+    sc16is750.enableSoftwareFlowControl();
+
+    std::vector<uint8_t> data = pattern(PAYLOAD);
+    sim->inject(data.data(), data.size());
+
+    size_t received = 0, xoffs = 0, xons = 0;
+    bool inOrder = true;
+    uint32_t start = millis();
+    uint32_t consumed = micros();
+    while (received < PAYLOAD && millis() - start < 1000) {
+        sc16is750.service();
+        if (micros() - consumed >= CONSUME_US) {
+            consumed = micros();
+            for (size_t i = 0; i < CONSUME && sc16is750.available(); i++)
+                inOrder &= sc16is750.read() == data[received++];
+        }
+        for (uint8_t c : sim->takeTransmitted()) {
+            xoffs += c == XOFF;
+            xons += c == XON;
+        }
+        delayMicroseconds(LOOP_US);
+    }
+
+    printf("rx       %u/%u, XOFF sent %u, XON sent %u, high water %u, "
+           "overruns %u\n",
+           (unsigned)received, (unsigned)PAYLOAD, (unsigned)xoffs,
+           (unsigned)xons, sc16is750.stats().rxHighWater, sim->overruns());
+    return received == PAYLOAD && inOrder && xoffs > 0 && xons > 0 &&
+           sim->overruns() == 0;
+}
+
+int main()
+{
+    HostArduino::useVirtualTime(true);
+
+    bool ok = transmitHalt();
+    ok &= receiveBackPressure();
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file sc16is7x0_pty.cpp
+ * @brief Expose a simulated SC16IS750 as a pseudo-terminal
+ * @details The simulated chip runs in real time, in internal loopback: what a
+ * terminal program writes to the PTY is sent at the programmed baudrate and
+ * comes back. Speed, stop bits and flow control follow the termios of the
+ * PTY. RTS is wired to CTS in loopback: with CRTSCTS, nothing is lost when
+ * the bridge is not scheduled in time.
+ *
+ *   sc16is7x0_pty [-b baudrate] [-f format] [-l link]
+ *
+ * The format (8N1 by default) sets the word length and the parity, which a PTY
+ * cannot carry.
+ *
+ * Prints the path of the slave side, runs until SIGINT / SIGTERM and prints
+ * the bridge counters on stderr. The bridge itself takes any SC16IS7X0, on
+ * any SC16IS7X0_BusIo.
+ */
+#include <Arduino.h>
+
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "SC16IS7X0.h"
+#include "SC16IS7X0_PtyBridge.h"
+#include "SC16IS7X0_Sim.h"
+
+constexpr uint32_t CRYSTAL_FREQ = 14745600;
+
+static SC16IS7X0_PtyBridge *bridge = nullptr;
+
+// "8N1", "7E2", ...
+static bool parseFormat(const char *text, SerialConfig *config)
+{
+    static const int bits[] = {UART_NB_BIT_5, UART_NB_BIT_6, UART_NB_BIT_7,
+                               UART_NB_BIT_8};
+    if (strlen(text) != 3 || text[0] < '5' || text[0] > '8')
+        return false;
+
+    int value = bits[text[0] - '5'];
+    switch (text[1]) {
+    case 'N':
+        value |= UART_PARITY_NONE;
+        break;
+    case 'E':
+        value |= UART_PARITY_EVEN;
+        break;
+    case 'O':
+        value |= UART_PARITY_ODD;
+        break;
+    default:
+        return false;
+    }
+    switch (text[2]) {
+    case '1':
+        value |= UART_NB_STOP_BIT_1;
+        break;
+    case '2':
+        value |= UART_NB_STOP_BIT_2;
+        break;
+    default:
+        return false;
+    }
+
+    *config = (SerialConfig)value;
+    return true;
+}
+
+static void onSignal(int)
+{
+    if (bridge)
+        bridge->stop();
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long baudrate = 115200;
+    SerialConfig config = SERIAL_8N1;
+    const char *link = nullptr;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "b:f:l:")) != -1) {
+        switch (opt) {
+        case 'b':
+            baudrate = strtoul(optarg, nullptr, 10);
+            break;
+        case 'f':
+            if (!parseFormat(optarg, &config)) {
+                fprintf(stderr, "unknown format %s\n", optarg);
+                return 2;
+            }
+            break;
+        case 'l':
+            link = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-b baudrate] [-f format] [-l link]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    SC16IS7X0_Sim sim(CRYSTAL_FREQ, SC16IS7X0_BusIo::SPI_BUS, 4000000);
+    SC16IS7X0 sc16is750(CRYSTAL_FREQ);
+    sc16is750.begin(sim);
+    sc16is750.begin_UART(baudrate, config);
+    sc16is750.enableLoopback();
+
+    SC16IS7X0_PtyBridge pty(sc16is750);
+    if (!pty.open(baudrate, config, link)) {
+        fprintf(stderr, "cannot open a PTY at %lu baud\n", baudrate);
+        return 1;
+    }
+    printf("%s\n", link ? link : pty.slaveName());
+    fflush(stdout);
+
+    bridge = &pty;
+    struct sigaction sa = {};
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    bool ok = pty.run();
+
+    const SC16IS7X0_PtyBridge::Stats &s = pty.stats();
+    fprintf(stderr,
+            "to pty %llu, from pty %llu, wake-ups %u, syscalls %u, "
+            "reconfigurations %u, rejected %u, RX FIFO overruns %u\n",
+            (unsigned long long)s.toPty, (unsigned long long)s.fromPty,
+            s.wakeups, s.syscalls, s.reconfigs, s.rejected, sim.overruns());
+    bridge = nullptr;
+    return ok ? 0 : 1;
+}
@@ -2,8 +2,8 @@
  * @file SC16IS7X0.h
  * @author Alexandre Maurer (alexmaurer@madis.ch)
  * @brief SC16IS740 / SC16IS750 / SC16IS760 library
- * @details Only SPI interface for the moment. Does currently not implement the
- usage of IRQ pin, IrDA, RS485 RTS control and 9-bit mode.
+ * @details SPI and I2C interfaces. The IRQ pin can be used to drain the RX
+ FIFO. Does currently not implement IrDA.
  *
  * @version 1.0.1
  * @date 2023-03-04
@@ -14,29 +14,181 @@
 
 #include "SC16IS7X0.h"
 
+using Regs = SC16IS7X0_Registers;
+
+// Out of class definition, needed before C++17
+constexpr uint32_t SC16IS7X0_BaudPlan::standard[];
+
 /**
  * @brief
  *
  * @param crystalClock Frequence in Hz of the XTAL1
  */
 SC16IS7X0::SC16IS7X0(uint32_t xtalFreq)
-    : _mcr(0x00), _lcr(0x03), _efr(0x00), _ioDir(0x00), _ioState(0x00),
-      busIo(nullptr) {
+    : _divisor(0), _baudPlan(), _charTimeNs(0), _txCredit(0), _txCreditStamp(0),
+      _irqPin(-1), _irqMode(false), _irqPending(false), _irqStamped(false),
+      _irqStamp(0), _irqServiceUs(0), _rxHeld(false), _stats(), _rxPollUs(0),
+      _rxPolled(false), _rxLeft(0), _txFillUs(0), _txBurstUs(0),
+      _pollSlackUs(0), _irqLatencyUs(0), _autoTrigger(false),
+      _autoMaxDelayUs(0), _autoFlow(false), _delimiter(-1),
+      _framesIn(0), _framesOut(0), _frameGap(false), _frameMinGapUs(0),
+      _frameLen(0), _lastRxUs(0), _lastRxExact(false), _rtsOvershoot(0),
+      _ioInputs(0), _ioValid(false), _pinChange(), _portSampleNs(0),
+      _txWaiting(false), _txArmed(false), busIo(nullptr),
+      _busOwner(BUS_BORROWED), _rxOp(), _txOp(), _rxRequest(0), _rxLevel(0),
+      _rxBusy(false), _txBusy(false), _spi(nullptr), _spiFreq(0),
+      _spiMode(SPI_MODE0), _csPin(0) {
   assert(xtalFreq > 0);
   _xtalFreq = xtalFreq;
 }
 
+SC16IS7X0::~SC16IS7X0() {
+#if SC16IS7X0_SERVICE_TASK
+  stopServiceTask();
+  if (_busMutex)
+    vSemaphoreDelete(_busMutex);
+#endif
+  releaseBusIo();
+}
+
 /**************************************************************************/
 /*!
   @brief Initialize using hardware SPI.
   @param cs_pin Pin to use for SPI chip select
   @param theSPI Pointer to SPI instance
+  @param freq SPI clock in Hz (4MHz max for SC16IS740/750, 15MHz for SC16IS760)
+  @param dataMode SPI mode, SPI_MODE0 or SPI_MODE3
   @return true if initialization successful, otherwise false.
 */
 /**************************************************************************/
-bool SC16IS7X0::begin_SPI(uint8_t cs_pin, SPIClass *theSPI) {
-  return setBusIo(SC16IS7X0_BusIo::buildSPI(
-      cs_pin, 4000000, SPI_BITORDER_MSBFIRST, SPI_MODE0, theSPI));
+bool SC16IS7X0::begin_SPI(uint8_t cs_pin, SPIClass *theSPI, uint32_t freq,
+                          uint8_t dataMode) {
+  _csPin = cs_pin;
+  _spi = theSPI;
+  _spiMode = dataMode;
+  _spiFreq = freq;
+  return buildSPI(freq);
+}
+
+#ifdef ESP32
+/**
+ * @brief Initialisation through the ESP-IDF SPI master driver
+ * @details FIFO bursts and register reads issued by service() are queued and
+ * transferred by DMA, service() returns without waiting for them. The SPI
+ * host is driven by ESP-IDF, it must not be used with SPIClass.
+ * probeSPIClock() is not available on this bus.
+ *
+ * @param cs_pin Chip select
+ * @param sck SPI clock pin
+ * @param miso MISO pin
+ * @param mosi MOSI pin
+ * @param freq SPI clock in Hz
+ * @param dataMode SPI_MODE0 or SPI_MODE3
+ * @param host SPI2_HOST or SPI3_HOST
+ * @return true if the SPI driver accepted the device
+ */
+bool SC16IS7X0::begin_SPI_DMA(uint8_t cs_pin, int8_t sck, int8_t miso,
+                              int8_t mosi, uint32_t freq, uint8_t dataMode,
+                              spi_host_device_t host) {
+  _csPin = cs_pin;
+  _spi = nullptr;
+  _spiMode = dataMode;
+  _spiFreq = freq;
+  return setBusIo(SC16IS7X0_BusIo::buildSPIDMA(cs_pin, sck, miso, mosi, freq,
+                                               dataMode, host),
+                  BUS_HEAP) &&
+         busIo->isAsync();
+}
+#endif
+
+/**
+ * @brief Find the fastest SPI clock the device and the wiring can sustain
+ * @details Test patterns are written to the Scratchpad Register and read back
+ * at increasing clocks, up to maxFreq. The bus is left one step below the
+ * first failing clock (two steps below the last passing one) to keep some
+ * margin, or at maxFreq if every step passed. Must be called after begin_SPI()
+ * and before begin_UART(): MCR[2] is cleared during the test to reach SPR.
+ *
+ * @param maxFreq Highest clock to try in Hz
+ * @return uint32_t The selected clock in Hz, 0 if the device did not answer
+ * at any clock (the bus is then left at the begin_SPI() clock)
+ */
+uint32_t SC16IS7X0::probeSPIClock(uint32_t maxFreq) {
+  static const uint32_t steps[] = {1000000,  2000000,  4000000,  6000000,
+                                   8000000,  10000000, 12000000, 15000000,
+                                   18000000, 20000000, 26000000};
+  const size_t count = sizeof(steps) / sizeof(steps[0]);
+
+  if (_spi == nullptr || busIo == nullptr)
+    return 0;
+
+  uint32_t initialFreq = _spiFreq;
+
+  // Start slow to reach SPR safely: TLR replaces it when MCR[2] and EFR[4] are
+  // set, as begin_UART() does
+  setSPIClock(steps[0]);
+  uint8_t mcr = readRegister(SC16IS7X0_MCR);
+  if (mcr & 0x04) {
+    uint8_t request[2] = {SC16IS7X0_MCR << 3, (uint8_t)(mcr & ~0x04)};
+    busIo->write(request, 2);
+  }
+
+  int lastPass = -1;
+  bool failed = false;
+  for (size_t i = 0; i < count && steps[i] <= maxFreq; i++) {
+    if (i > 0)
+      setSPIClock(steps[i]);
+    if (!testScratchpad()) {
+      failed = true;
+      break;
+    }
+    lastPass = i;
+  }
+
+  uint32_t freq = 0;
+  if (lastPass >= 0) {
+    int selected = lastPass;
+    if (failed && selected > 0)
+      selected--;
+    freq = steps[selected];
+  }
+
+  // Restore MCR at the lowest clock, then settle
+  setSPIClock(steps[0]);
+  if (mcr & 0x04) {
+    uint8_t request[2] = {SC16IS7X0_MCR << 3, mcr};
+    busIo->write(request, 2);
+  }
+
+  _spiFreq = freq ? freq : initialFreq;
+  setSPIClock(_spiFreq);
+  // A failing clock may have written elsewhere than SPR
+  _regs.reset();
+  _ioValid = false;
+  return freq;
+}
+
+/**
+ * @brief Write and read back test patterns through the Scratchpad Register
+ *
+ * @return true if every pattern has been read back unchanged
+ */
+bool SC16IS7X0::testScratchpad(void) {
+  static const uint8_t patterns[] = {0x55, 0xAA, 0x00, 0xFF, 0x01, 0x02,
+                                     0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                                     0xFE, 0x7F, 0x5A, 0xA5};
+
+  // Repeated to catch marginal timings
+  for (uint8_t round = 0; round < 4; round++) {
+    for (uint8_t pattern : patterns) {
+      uint8_t request[2] = {SC16IS7X0_SPR << 3, pattern};
+      if (!busIo->write(request, 2))
+        return false;
+      if (readRegister(SC16IS7X0_SPR) != pattern)
+        return false;
+    }
+  }
+  return true;
 }
 
 /**
@@ -50,7 +202,40 @@ bool SC16IS7X0::begin_SPI(uint8_t cs_pin, SPIClass *theSPI) {
  *          data-sheet must be right-shifted one bit
  */
 bool SC16IS7X0::begin_I2C(uint8_t addr, TwoWire *theWire) {
-  return setBusIo(SC16IS7X0_BusIo::buildI2C(addr, theWire));
+  _spi = nullptr;
+  _spiFreq = 0;
+  releaseBusIo();
+  return setBusIo(SC16IS7X0_BusIo::buildI2C(&_busStorage, addr, theWire),
+                  BUS_IN_PLACE);
+}
+
+/**
+ * @brief Initialisation with a user provided bus
+ * @details For transports not covered by begin_SPI() / begin_I2C(), or a
+ * simulated device (see extras/host). The object takes ownership of the bus.
+ *
+ * @param theBusIo Bus to the device, allocated with new
+ * @return true if theBusIo is not null
+ */
+bool SC16IS7X0::begin(SC16IS7X0_BusIo *theBusIo) {
+  _spi = nullptr;
+  _spiFreq = 0;
+  return setBusIo(theBusIo, BUS_HEAP);
+}
+
+/**
+ * @brief Initialisation with a user provided bus, kept by the caller
+ * @details Same as begin(SC16IS7X0_BusIo *) without taking ownership: the
+ * bus may be a static or a member object, it must outlive the device or the
+ * next begin*() call.
+ *
+ * @param theBusIo Bus to the device
+ * @return true
+ */
+bool SC16IS7X0::begin(SC16IS7X0_BusIo &theBusIo) {
+  _spi = nullptr;
+  _spiFreq = 0;
+  return setBusIo(&theBusIo, BUS_BORROWED);
 }
 
 /**
@@ -58,8 +243,11 @@ bool SC16IS7X0::begin_I2C(uint8_t addr, TwoWire *theWire) {
  *
  * @param baudrate Desired baudrate
  * @param config Serial configuration
+ * @param maxErrorPpm Largest baudrate error accepted, see updateBaudRate()
+ * @return false if the baudrate has been rejected, the format is set anyway
  */
-void SC16IS7X0::begin_UART(unsigned long baudrate, SerialConfig config) {
+bool SC16IS7X0::begin_UART(unsigned long baudrate, SerialConfig config,
+                           uint32_t maxErrorPpm) {
   // Enable enhanced function to be able to change the clock prescaler
   enableEnhancedFunctions();
   // Enable embedded 64 bytes FIFO for RX and TX
@@ -77,78 +265,57 @@ void SC16IS7X0::begin_UART(unsigned long baudrate, SerialConfig config) {
   uint8_t parity = getParity(config);
 
   // Create LCR Register value
-  _lcr = 0x00;
-  _lcr = (parity | stopBits | wordLength);
+  _regs.set(Regs::LCR, parity | stopBits | wordLength);
 
-  // Write Register
-  uint8_t request[2] = {SC16IS7X0_LCR << 3, _lcr};
-  busIo->write(request, 2);
+  // Sent together with the divisor in one transaction
+  bool ok = updateBaudRate(baudrate, maxErrorPpm);
+  commitRegisters();
 
-  updateBaudRate(baudrate);
+  // Seed the TX credit
+  _txCredit = txlvl();
+  _txCreditStamp = micros();
+  return ok;
 }
 
 /**
  * @brief Update baudrate
+ * @details The divisor and the prescaler come from SC16IS7X0_BaudPlan::make(),
+ * the divisor rounded to the nearest value for both prescalers. A baudrate
+ * that cannot be reached within maxErrorPpm is rejected, the previous one is
+ * kept. getBaudPlan() reports the actual baudrate and its error.
  *
  * @param baudrate new baudrate value in Hz. max 5MHz
+ * @param maxErrorPpm Largest error accepted, in parts per million
+ * @return true if the baudrate has been programmed
  */
-void SC16IS7X0::updateBaudRate(unsigned long baudrate) {
+bool SC16IS7X0::updateBaudRate(unsigned long baudrate, uint32_t maxErrorPpm) {
   assert(baudrate > 0 && baudrate <= 5000000);
 
-  /**
-   * @brief Divisor formula
-   * Divisor = (XTAL1 freq / prescaler) / (Desired baudrate x 16)
-   */
-
-  uint32_t xtalFreqDivBy4 = _xtalFreq >> 2;
-  uint32_t baudrateClock = baudrate << 4;
-
-  // Calculate divisor and remainder for both prescaler
-  uint32_t divisor1 = _xtalFreq / baudrateClock;
-  uint32_t remainder1 = _xtalFreq % baudrateClock;
-  uint32_t divisor4 = xtalFreqDivBy4 / baudrateClock;
-  uint32_t remainder4 = xtalFreqDivBy4 % baudrateClock;
-
-  // Serial.print("baudrate update ");
-  // Serial.print(baudrate);
-  // Serial.print(" ");
-  // Serial.print(divisor1);
-  // Serial.print(" ");
-  // Serial.print(remainder1);
-  // Serial.print(" ");
-  // Serial.print(divisor4);
-  // Serial.print(" ");
-  // Serial.println(remainder4);
-
-  uint8_t lastTry = false;
-  if (divisor1 == 0 || divisor1 > 0xFFFF) {
-    // Bad divisor
-    lastTry = true;
-  } else if (remainder1 == 0) {
-    // Perfect match
-    writeDivisorAndPrescaler(divisor1, DIVIDE_BY_1);
-    return;
-  }
-
-  // Second try with /4 prescaler
-  if (divisor4 == 0 || divisor4 > 0xFFFF) {
-    // Bad divisor
-
-    // No other possibility
-    if (lastTry)
-      return;
-
-    writeDivisorAndPrescaler(divisor1, DIVIDE_BY_1);
-    return;
-  }
+  SC16IS7X0_BaudPlan plan = SC16IS7X0_BaudPlan::make(_xtalFreq, baudrate);
+  if (!plan.within(maxErrorPpm))
+    return false;
 
-  // Here we are able to choose the divisor with the best remainder
-  if (remainder4 < remainder1)
-    writeDivisorAndPrescaler(divisor4, DIVIDE_BY_4);
-  else
-    writeDivisorAndPrescaler(divisor1, DIVIDE_BY_1);
+  writeDivisorAndPrescaler(plan.divisor,
+                           plan.prescaler == 4 ? DIVIDE_BY_4 : DIVIDE_BY_1);
+  _baudPlan = plan;
+  return true;
+}
 
-  return;
+/**
+ * @brief Update the frame format
+ * @details Word length, parity and stop bits are written to LCR in one
+ * transaction, the baudrate is kept. A character being shifted meanwhile is
+ * corrupted, call flush() before to let the pending ones go out in the
+ * previous format.
+ *
+ * @param config Serial configuration
+ */
+void SC16IS7X0::updateConfig(SerialConfig config) {
+  // LCR[6] break is kept
+  _regs.set(Regs::LCR, (_regs.get(Regs::LCR) & 0x40) | getParity(config) |
+                           getStopBits(config) | getWordLength(config));
+  commitRegisters();
+  updateCharTime();
 }
 
 /**
@@ -156,50 +323,24 @@ void SC16IS7X0::updateBaudRate(unsigned long baudrate) {
  *
  */
 void SC16IS7X0::enableEnhancedFunctions(void) {
-  uint8_t request[2];
-
-  // Set LCR Register to 0xBF to access Enhanced register set
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = 0xBF;
-  busIo->write(request, 2);
-
-  // Write EFR Register to enable enhanced functions
-  _efr |= (0x01 << 4);
-  request[0] = SC16IS7X0_EFR << 3;
-  request[1] = _efr;
-  busIo->write(request, 2);
-
-  // Set back LCR Register value
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = _lcr;
-  busIo->write(request, 2);
+  // EFR[4] enables the enhanced functions
+  _regs.update(Regs::EFR, 0x01 << 4, true);
 }
 
 /**
  * @brief Enable TX and RX 64 bytes FIFO
  *
  */
-void SC16IS7X0::enableFIFO(void) {
-  uint8_t request[2];
-
-  request[0] = SC16IS7X0_FCR << 3;
-  request[1] = 0x01;
-  busIo->write(request, 2);
-}
+void SC16IS7X0::enableFIFO(void) { _regs.update(Regs::FCR, 0x01, true); }
 
 /**
  * @brief Enable internal loopback mode
  *
  */
 void SC16IS7X0::enableLoopback(void) {
-  uint8_t request[2];
-
-  _mcr |= 0x01 << 4;
-
-  // Write MCR Register
-  request[0] = SC16IS7X0_MCR << 3;
-  request[1] = _mcr;
-  busIo->write(request, 2);
+  // MCR[4] loopback
+  _regs.update(Regs::MCR, 0x01 << 4, true);
+  commitRegisters();
 }
 
 /**
@@ -207,14 +348,9 @@ void SC16IS7X0::enableLoopback(void) {
  *
  */
 void SC16IS7X0::disableLoopback(void) {
-  uint8_t request[2];
-
-  _mcr &= ~(0x01 << 4);
-
-  // Write MCR Register
-  request[0] = SC16IS7X0_MCR << 3;
-  request[1] = _mcr;
-  busIo->write(request, 2);
+  // MCR[4] loopback
+  _regs.update(Regs::MCR, 0x01 << 4, false);
+  commitRegisters();
 }
 
 /**
@@ -222,14 +358,8 @@ void SC16IS7X0::disableLoopback(void) {
  *
  */
 void SC16IS7X0::enableTCR_TLR(void) {
-  uint8_t request[2];
-
-  _mcr |= 0x01 << 2;
-
-  // Write MCR Register
-  request[0] = SC16IS7X0_MCR << 3;
-  request[1] = _mcr;
-  busIo->write(request, 2);
+  // MCR[2] TCR and TLR enable
+  _regs.update(Regs::MCR, 0x01 << 2, true);
 }
 
 /**
@@ -237,14 +367,8 @@ void SC16IS7X0::enableTCR_TLR(void) {
  *
  */
 void SC16IS7X0::disableTCR_TLR(void) {
-  uint8_t request[2];
-
-  _mcr &= ~(0x01 << 2);
-
-  // Write MCR Register
-  request[0] = SC16IS7X0_MCR << 3;
-  request[1] = _mcr;
-  busIo->write(request, 2);
+  // MCR[2] TCR and TLR enable
+  _regs.update(Regs::MCR, 0x01 << 2, false);
 }
 
 /**
@@ -255,78 +379,396 @@ void SC16IS7X0::disableTCR_TLR(void) {
  */
 void SC16IS7X0::writeDivisorAndPrescaler(uint32_t divisor,
                                          Prescaler prescaler) {
-  uint8_t request[2];
+  // Change clock divisor bit MCR[7] (needs EFR[4])
+  enableEnhancedFunctions();
+  _regs.update(Regs::MCR, 0b10000000, prescaler == DIVIDE_BY_4);
+
+  // Special registers DLH and DLL, LCR[7] is handled by the shadow
+  _regs.set(Regs::DLH, (divisor >> 8) & 0xFF);
+  _regs.set(Regs::DLL, divisor & 0xFF);
+  commitRegisters();
+
+  _divisor = divisor;
+  updateCharTime();
+}
+
+/**
+ * @brief Compute the duration of one character on the line from the divisor,
+ * the prescaler and the frame format of LCR
+ *
+ */
+void SC16IS7X0::updateCharTime(void) {
+  uint8_t lcr = _regs.get(Regs::LCR);
+
+  // Start bit, word length, parity and stop bits counted in half bits
+  uint32_t halfBits = 2 + 2 * (5 + (lcr & 0x03));
+  if (lcr & 0x08)
+    halfBits += 2;
+  if (lcr & 0x04)
+    halfBits += (lcr & 0x03) == 0 ? 3 : 4; // 1.5 stop bits with 5 bits words
+  else
+    halfBits += 2;
+
+  // Bit time = 16 x divisor x prescaler / XTAL1
+  uint32_t prescaler = (_regs.get(Regs::MCR) & 0x80) ? 4 : 1;
+  uint64_t ns = (uint64_t)halfBits * 8000000000ULL * _divisor * prescaler;
+  _charTimeNs = (uint32_t)(ns / _xtalFreq);
+}
+
+/**
+ * @brief Queue a single byte for transmission
+ *
+ * @param c byte to send
+ * @return size_t Return 1 once the byte is in the software TX buffer
+ */
+size_t SC16IS7X0::write(uint8_t c) { return write(&c, 1); }
+
+/**
+ * @brief Queue one or more bytes for transmission
+ * @details Bytes are copied into the software TX buffer and pushed to the TX
+ * FIFO in bursts, right away as far as the FIFO has room, then from the THR
+ * interrupt and service(). Only blocks while the software TX buffer is full,
+ * service() keeps draining the RX FIFO meanwhile.
+ *
+ * @param buffer Buffer pointer
+ * @param size size of data to transmit
+ * @return size_t Return size
+ */
+size_t SC16IS7X0::write(const uint8_t *buffer, size_t size) {
+  size_t queued = 0;
+
+  for (;;) {
+    queued += _txBuf.push(buffer + queued, size - queued);
+    if (ownsBus())
+      fillTxFifo();
+    else
+      wakeServiceTask();
+    if (queued == size)
+      break;
+
+    // Software TX buffer full, wait for the FIFO to make room
+    if (!ownsBus()) {
+      waitServiceTask();
+      continue;
+    }
+    // The RX FIFO keeps being drained meanwhile
+    service();
+    yield();
+  }
+
+  return size;
+}
+
+/**
+ * @brief Return the free space of the software TX buffer
+ *
+ * @return int
+ */
+int SC16IS7X0::availableForWrite(void) { return (int)_txBuf.free(); }
+
+/**
+ * @brief Wait until every queued byte has been shifted out
+ *
+ */
+void SC16IS7X0::flush(void) {
+#if SC16IS7X0_SERVICE_TASK
+  if (!ownsBus()) {
+    // The service task reads LSR once the software buffer is empty
+    _flushing = true;
+    wakeServiceTask();
+    while (_flushing)
+      waitServiceTask();
+    return;
+  }
+#endif
+
+  while (!_txBuf.empty()) {
+    service();
+    yield();
+  }
 
-  // Change clock divisor bit
-  if (prescaler == DIVIDE_BY_1) {
-    _mcr &= ~(0b10000000);
-  } else if (prescaler == DIVIDE_BY_4) {
-    _mcr |= 0b10000000;
+  // What TXLVL reports as queued, plus the character in TSR, cannot leave
+  // sooner: wait for it without touching the bus
+  uint32_t queued = SC16IS7X0_FIFO_SIZE - txlvl() + 1;
+  uint32_t until = micros() + (uint32_t)((uint64_t)_charTimeNs * queued / 1000);
+  while ((int32_t)(micros() - until) < 0)
+    yield();
+
+  // LSR[6] THR and TSR empty, read at most once per character time
+  uint32_t charUs = _charTimeNs / 1000 + 1;
+  for (;;) {
+    uint8_t lsr = readRegister(SC16IS7X0_LSR);
+    recordLsr(lsr);
+    if (lsr & 0x40)
+      break;
+    until = micros() + charUs;
+    while ((int32_t)(micros() - until) < 0)
+      yield();
   }
+}
 
-  // Write MCR Register
-  request[0] = SC16IS7X0_MCR << 3;
-  request[1] = _mcr;
-  busIo->write(request, 2);
+/**
+ * @brief Move data between the FIFOs and the software buffers
+ * @details In polled mode call it regularly: the RX FIFO is read ahead into
+ * the software RX buffer before it overruns and the TX FIFO is fed from the
+ * software TX buffer. RXLVL is only read once nextServiceDeadline() has been
+ * reached, so calling it more often costs no bus transaction. On an
+ * asynchronous bus (begin_SPI_DMA()) the reads and the bursts are queued and
+ * completed by the following calls, the CPU does not wait for them. In
+ * interrupt mode it serves the pending interrupt, if any, and refills the TX
+ * FIFO as the credit allows.
+ */
+void SC16IS7X0::service(void) {
+  if (busIo == nullptr)
+    return;
+  if (!ownsBus()) {
+    wakeServiceTask();
+    return;
+  }
 
-  // Set LCR[7] bit to write to special registers LDD and LDH
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = _lcr | 0x80;
-  busIo->write(request, 2);
+  // Callbacks of the transactions completed since the last call
+  busIo->poll();
+  checkFrameGap();
 
-  // Write the most significant part of the divisor
-  request[0] = SC16IS7X0_DLH << 3;
-  request[1] = (divisor >> 8) & 0xFF;
-  busIo->write(request, 2);
+  if (_irqMode) {
+    serviceInterrupt();
+    // The last burst left the FIFO above the TX trigger level, no THR
+    // interrupt will ask for more
+    if (!_txArmed)
+      fillTxFifo();
+    return;
+  }
 
-  // Write the least significant part of the divisor
-  request[0] = SC16IS7X0_DLL << 3;
-  request[1] = divisor & 0xFF;
-  busIo->write(request, 2);
+  int32_t late = (int32_t)(micros() - rxDeadline());
+  if (!_rxBuf.full() && late >= 0) {
+    // On an asynchronous bus, measured once RXLVL has been read
+    if (busIo->isAsync()) {
+      requestRx();
+    } else {
+      updatePollSlack(late);
+      drainRxFifo();
+    }
+    if (_autoFlow)
+      tuneFlowControlLevels();
+  }
+  fillTxFifo();
+}
 
-  // Reset LCR[7] bit
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = _lcr;
-  busIo->write(request, 2);
+/**
+ * @brief Time (micros()) by which service() should be called
+ * @details Polled mode: characters may arrive at the line rate, from the
+ * level left in the RX FIFO by the last RXLVL read. service() is due before
+ * the FIFO can hold more than SC16IS7X0_FIFO_SIZE - SC16IS7X0_POLL_RESERVE
+ * characters, earlier by the lateness of the previous calls. While bytes wait
+ * in the software TX buffer, it is also due before the TX FIFO runs dry. Idle
+ * ports are thus polled once per FIFO worth of character times, busy ones as
+ * soon as their FIFO may be full.
+ *
+ * Interrupt mode: due once the IRQ pin has been asserted, unless the software
+ * RX buffer has been found full and not emptied since, otherwise
+ * SC16IS7X0_POLL_IDLE_US after the last service of the interrupt. service()
+ * then reads IIR, RXLVL and TXLVL (while bytes wait to be sent) although the
+ * pin is released, in case an edge has been missed. While bytes wait in the
+ * software TX buffer and the last burst left more free space than the TX
+ * trigger level, also due before the TX FIFO runs dry: no THR interrupt will
+ * come. With transactions in flight on an asynchronous bus: due now. In both
+ * modes, no later than the end of the frame being received with
+ * enableFrameGap().
+ *
+ * @return uint32_t Deadline in micros() time, now or in the past if due
+ */
+uint32_t SC16IS7X0::nextServiceDeadline(void) const {
+  uint32_t now = micros();
+  if (busIo == nullptr)
+    return now + SC16IS7X0_POLL_IDLE_US;
+  if (_rxBusy || _txBusy)
+    return now;
+
+  if (_irqMode && _irqPending && !rxHeld())
+    return now;
+
+  uint32_t deadline =
+      _irqMode ? _irqServiceUs + SC16IS7X0_POLL_IDLE_US : rxDeadline();
+  // An open frame is closed once the line has been silent long enough
+  if (frameTimed() && (int32_t)(frameDeadline() - deadline) < 0)
+    deadline = frameDeadline();
+
+  if (!_txBuf.empty() && !(_irqMode && _txArmed)) {
+    // Refill once 3/4 of the last known FIFO content have been shifted out
+    int chars = (SC16IS7X0_FIFO_SIZE - _txCredit) * 3 / 4;
+    if (chars < SC16IS7X0_FIFO_SIZE / 4)
+      chars = SC16IS7X0_FIFO_SIZE / 4;
+    uint32_t tx = _txFillUs + windowUs(chars);
+    // Without credit, TXLVL is not read again before txCredit() allows it
+    if (_txCredit == 0) {
+      uint32_t refresh =
+          _txCreditStamp +
+          (uint32_t)(((uint64_t)_charTimeNs * (SC16IS7X0_FIFO_SIZE / 4)) /
+                     1000);
+      if ((int32_t)(refresh - tx) > 0)
+        tx = refresh;
+    }
+    if ((int32_t)(tx - deadline) < 0)
+      deadline = tx;
+  }
+  return deadline;
 }
 
 /**
- * @brief Write single byte into the TX FIFO
+ * @brief Read RXLVL late, poll earlier from now on
  *
- * @param c byte to send
- * @return size_t Return 1 if the byte has been pushed into the FIFO otherwise 0
- * if the FIFO was full.
+ * @param late Time from rxDeadline() to the RXLVL read, negative if early
  */
-size_t SC16IS7X0::write(uint8_t c) {
-  uint8_t free = txlvl();
-  if (free < 1)
+void SC16IS7X0::updatePollSlack(int32_t late) {
+  if (!_rxPolled || late < 0)
+    return;
+  if (late > (int32_t)_pollSlackUs)
+    _pollSlackUs = (uint32_t)late;
+  else
+    _pollSlackUs -= _pollSlackUs / 8;
+}
+
+/**
+ * @brief Time (micros()) by which RXLVL must be read again
+ */
+uint32_t SC16IS7X0::rxDeadline(void) const {
+  if (!_rxPolled)
+    return micros();
+  return _rxPollUs +
+         windowUs(SC16IS7X0_FIFO_SIZE - SC16IS7X0_POLL_RESERVE - _rxLeft);
+}
+
+/**
+ * @brief Duration of chars characters on the line, shortened by the lateness
+ * observed on service()
+ */
+uint32_t SC16IS7X0::windowUs(int chars) const {
+  if (chars <= 0)
     return 0;
+  uint32_t us = (uint32_t)((uint64_t)_charTimeNs * chars / 1000);
+  return us > _pollSlackUs ? us - _pollSlackUs : 0;
+}
+
+/**
+ * @brief true if reading RXLVL may find new characters: never more than once
+ * per character time
+ */
+bool SC16IS7X0::rxPollDue(uint32_t now) const {
+  if (!_rxPolled)
+    return true;
+  return (now - _rxPollUs) * 1000ULL >= _charTimeNs;
+}
 
-  uint8_t request[2] = {(SC16IS7X0_THR << 3), c};
-  busIo->write(request, 2);
+/**
+ * @brief Push as much of the software TX buffer as the TX FIFO accepts
+ *
+ * @param refresh Read TXLVL even if the credit says the FIFO is full
+ */
+void SC16IS7X0::fillTxFifo(bool refresh) {
+  // On asynchronous buses one burst is in flight at a time
+  if (!_txBuf.empty() && !_txBusy) {
+    size_t len = txCredit(_txBuf.size(), refresh);
+    if (len > _txBuf.size())
+      len = _txBuf.size();
+
+    if (len > 0 && busIo->isAsync()) {
+      // The data leaves the software buffer once the burst is complete
+      size_t chunk = busIo->maxTransferSize() - 1;
+      if (len > chunk)
+        len = chunk;
+      _txData[0] = SC16IS7X0_THR << 3;
+      _txBuf.peek(_txData + 1, len);
+      _txCredit -= len;
+
+      // The reads queued after the burst wait for it: read RXLVL first if
+      // it falls due meanwhile
+      if (!_rxBuf.full() &&
+          (int32_t)(micros() + _txBurstUs - rxDeadline()) >= 0)
+        requestRx();
+
+      _txOp = {_txData, len + 1, nullptr, 0, onTxDone, this, nullptr};
+      _txBusy = busIo->submit(&_txOp);
+      if (_txBusy)
+        countBus(len + 1, 0);
+      else
+        _txCredit = 0;
+      _txWaiting = _txBuf.size() > len;
+      _txFillUs = micros();
+      _txArmed = false;
+    } else if (len > 0) {
+      uint8_t data[SC16IS7X0_FIFO_SIZE];
+      _txBuf.peek(data, len);
+
+      size_t sent = writeFifo(data, len);
+      _txBuf.skip(sent);
+      _txCredit -= sent;
+      _stats.txBytes += sent;
+      _txWaiting = !_txBuf.empty();
+      _txFillUs = micros();
+
+      // Unknown FIFO state after a bus error, read TXLVL next time
+      if (sent < len)
+        _txCredit = 0;
+
+      // Writing THR clears the THR interrupt. It comes back once the free
+      // space rises to the TX trigger level, provided the burst left less:
+      // the credit plus what has been shifted out since TXLVL was read.
+      uint32_t shifted =
+          _charTimeNs ? (uint32_t)((uint64_t)(_txFillUs - _txCreditStamp) *
+                                   1000 / _charTimeNs)
+                      : 0;
+      _txArmed = sent == len && _txCredit + shifted < getTxTriggerLevel();
+    }
+  }
 
-  return 1;
+  updateTxInterrupt();
 }
 
 /**
- * @brief Write one or more bytes into the TX FIFO
+ * @brief Number of bytes that can be pushed into the TX FIFO
+ * @details The credit is seeded from TXLVL and decremented on every push, so
+ * consecutive writes do not read TXLVL. TXLVL is read again only when the
+ * credit does not cover the request and enough time has passed for the
+ * transmitter to free a quarter of the FIFO. Meanwhile small writes pile up in
+ * the software TX buffer and leave in one burst.
  *
- * @param buffer Buffer pointer
- * @param size size of data to transmit
- * @return size_t Return the number of bytes pushed into the FIFO. Can be less
- * than size.
+ * @param wanted Number of bytes waiting
+ * @param refresh Read TXLVL whenever the credit does not cover the request
+ * @return size_t Free space of the TX FIFO, never more than the real one
  */
-size_t SC16IS7X0::write(const uint8_t *buffer, size_t size) {
-  size_t free = (size_t)txlvl();
-  if (free < size)
-    size = free;
+size_t SC16IS7X0::txCredit(size_t wanted, bool refresh) {
+  if (_txCredit >= wanted || _txCredit >= SC16IS7X0_FIFO_SIZE)
+    return _txCredit;
 
-  if (size == 0)
-    return 0;
+  uint32_t now = micros();
+  uint32_t refreshUs =
+      (uint32_t)(((uint64_t)_charTimeNs * (SC16IS7X0_FIFO_SIZE / 4)) / 1000);
 
-  uint8_t request[1] = {SC16IS7X0_THR << 3};
-  busIo->write(buffer, size, request, 1);
-  return size;
+  if (refresh || (uint32_t)(now - _txCreditStamp) >= refreshUs) {
+    _txCredit = txlvl();
+    _txCreditStamp = now;
+
+    // The transmitter ran dry while bytes were left behind by the last fill
+    if (_txWaiting && _txCredit >= SC16IS7X0_FIFO_SIZE)
+      _stats.txStarved++;
+  }
+
+  return _txCredit;
+}
+
+/**
+ * @brief Enable the THR interrupt (IER[1]) only while bytes are waiting in
+ * the software TX buffer
+ *
+ */
+void SC16IS7X0::updateTxInterrupt(void) {
+  bool enable = _irqMode && !_txBuf.empty();
+  // Raised as soon as the FIFO has room once enabled
+  if (enable && !(_regs.get(Regs::IER) & 0x02))
+    _txArmed = true;
+  // Nothing is sent if IER[1] is already in the wanted state
+  _regs.update(Regs::IER, 0x02, enable);
+  commitRegisters();
 }
 
 /**
@@ -334,17 +776,92 @@ size_t SC16IS7X0::write(const uint8_t *buffer, size_t size) {
  *
  * @return uint8_t
  */
-uint8_t SC16IS7X0::txlvl(void) {
-  uint8_t request[1] = {(SC16IS7X0_TXLVL << 3) | SC16IS7X0_READ_FLAG};
-  uint8_t txlvl;
-  busIo->write_then_read(request, 1, &txlvl, 1);
-  return txlvl;
+uint8_t SC16IS7X0::txlvl(void) { return readRegister(SC16IS7X0_TXLVL); }
+
+/**
+ * @brief Read a register of the general register set
+ *
+ * @param reg Register address
+ * @return uint8_t Register value
+ */
+uint8_t SC16IS7X0::readRegister(uint8_t reg) {
+  uint8_t request[1] = {(uint8_t)((reg << 3) | SC16IS7X0_READ_FLAG)};
+  uint8_t val = 0;
+  busIo->write_then_read(request, 1, &val, 1);
+  countBus(1, 1);
+  return val;
 }
 
-bool SC16IS7X0::setBusIo(SC16IS7X0_BusIo *theBusIo) {
-  if (busIo)
-    delete busIo; // delete old instance
+/**
+ * @brief Read bytes from the RX FIFO
+ * @details The transfer is split in the largest chunks the transport accepts,
+ * each one addressing RHR again. The subaddress does not auto-increment, any
+ * other register is read repeatedly the same way.
+ *
+ * @param buffer Destination
+ * @param len Number of bytes to read
+ * @param reg Register read, RHR by default
+ * @return size_t Number of bytes read, less than len after a bus error
+ */
+size_t SC16IS7X0::readFifo(uint8_t *buffer, size_t len, uint8_t reg) {
+  uint8_t request[1] = {(uint8_t)((reg << 3) | SC16IS7X0_READ_FLAG)};
+  size_t chunk = busIo->maxTransferSize();
+  if (chunk == 0)
+    return 0;
+
+  size_t done = 0;
+  while (done < len) {
+    size_t n = len - done;
+    if (n > chunk)
+      n = chunk;
+    countBus(1, n);
+    if (!busIo->write_then_read(request, 1, buffer + done, n))
+      break;
+    done += n;
+  }
+  return done;
+}
+
+/**
+ * @brief Write bytes into the TX FIFO
+ * @details The transfer is split in the largest chunks the transport accepts,
+ * each one addressing THR again. The subaddress does not auto-increment, any
+ * other register is written repeatedly the same way.
+ *
+ * @param buffer Source
+ * @param len Number of bytes to write
+ * @param reg Register written, THR by default
+ * @return size_t Number of bytes written, less than len after a bus error
+ */
+size_t SC16IS7X0::writeFifo(const uint8_t *buffer, size_t len, uint8_t reg) {
+  uint8_t request[1] = {(uint8_t)(reg << 3)};
+  // The subaddress takes one byte of each transaction
+  size_t chunk = busIo->maxTransferSize();
+  if (chunk < 2)
+    return 0;
+  chunk--;
+
+  size_t done = 0;
+  while (done < len) {
+    size_t n = len - done;
+    if (n > chunk)
+      n = chunk;
+    countBus(1 + n, 0);
+    if (!busIo->write(buffer + done, n, request, 1))
+      break;
+    done += n;
+  }
+  return done;
+}
+
+bool SC16IS7X0::setBusIo(SC16IS7X0_BusIo *theBusIo, BusOwner owner) {
+  releaseBusIo();
   busIo = theBusIo;
+  _busOwner = owner;
+
+  // New device, nothing is known about its registers
+  _regs.reset();
+  _ioValid = false;
 
   if (busIo)
     return true;
@@ -352,8 +869,45 @@ bool SC16IS7X0::setBusIo(SC16IS7X0_BusIo *theBusIo) {
     return false;
 }
 
+/**
+ * @brief Detach the bus, destroying it unless it is borrowed
+ *
+ */
+void SC16IS7X0::releaseBusIo(void) {
+  if (busIo == nullptr)
+    return;
+
+  busIo->drain(); // complete the transactions pointing to this object
+  if (_busOwner == BUS_HEAP)
+    delete busIo;
+  else if (_busOwner == BUS_IN_PLACE)
+    busIo->~SC16IS7X0_BusIo(); // _busStorage is free again
+  busIo = nullptr;
+}
+
+/**
+ * @brief Use the SPI bus at a given clock, built in place
+ *
+ */
+bool SC16IS7X0::buildSPI(uint32_t freq) {
+  releaseBusIo();
+  return setBusIo(SC16IS7X0_BusIo::buildSPI(&_busStorage, _csPin, freq,
+                                            SPI_BITORDER_MSBFIRST, _spiMode,
+                                            _spi),
+                  BUS_IN_PLACE);
+}
+
+/**
+ * @brief Change the clock of the SPI transport built by begin_SPI(), without
+ * rebuilding it
+ *
+ */
+void SC16IS7X0::setSPIClock(uint32_t freq) {
+  static_cast<SC16IS7X0_SPI *>(busIo)->setClock(freq);
+}
+
 uint8_t SC16IS7X0::getWordLength(SerialConfig config) {
-  uint8_t wordLength;
+  uint8_t wordLength = 0x03;
 
   // Word Length
   switch (config & UART_NB_BIT_MASK) {
@@ -378,7 +932,7 @@ uint8_t SC16IS7X0::getWordLength(SerialConfig config) {
 }
 
 uint8_t SC16IS7X0::getParity(SerialConfig config) {
-  uint8_t parity;
+  uint8_t parity = 0x00;
 
   switch (config & UART_PARITY_MASK) {
   case UART_PARITY_EVEN:
@@ -427,190 +981,1424 @@ uint8_t SC16IS7X0::getStopBits(SerialConfig config) {
 }
 
 /**
- * @brief Return the available char in RX FIFO
+ * @brief Use the IRQ pin to receive data
+ * @details RHR (trigger level and time-out) and receiver line status
+ * interrupts are enabled. Once the IRQ pin has been pulled low, the next call
+ * to available(), read(), peek() or handleInterrupt() drains the RX FIFO into
+ * the software RX buffer. Otherwise these functions are served from RAM
+ * without any bus transaction.
  *
- * @return int
+ * @param irqPin MCU pin connected to the IRQ output (open-drain, active low)
+ * @return true if the pin supports interrupts
  */
-int SC16IS7X0::available(void) {
-  uint8_t request[1] = {(SC16IS7X0_RXLVL << 3) | SC16IS7X0_READ_FLAG};
-  uint8_t rxlvl;
-  busIo->write_then_read(request, 1, &rxlvl, 1);
-  return (int)rxlvl;
-}
+bool SC16IS7X0::enableInterrupt(uint8_t irqPin) {
+  int irq = digitalPinToInterrupt(irqPin);
+  if (irq == NOT_AN_INTERRUPT)
+    return false;
 
-/**
- * @brief Return a single character
- *
- * @return int
- */
-int SC16IS7X0::read(void) {
-  if (available() == 0)
-    return -1;
+  if (_irqPin >= 0)
+    detachInterrupt(digitalPinToInterrupt(_irqPin));
 
-  uint8_t request[1] = {(SC16IS7X0_RHR << 3) | SC16IS7X0_READ_FLAG};
-  uint8_t val;
-  busIo->write_then_read(request, 1, &val, 1);
-  return (int)val;
+  _irqPin = irqPin;
+  ::pinMode(irqPin, INPUT_PULLUP);
+  attachInterruptArg(irq, irqHandler, this, FALLING);
+
+  startInterruptMode();
+  return true;
 }
 
 /**
- * @brief Read one or more bytes from the RX FIFO
- *
- * @param buffer Destination pointer to transfert RX bytes
- * @param len Number of bytes to read
- * @return int Return the real size of data that has been read
+ * @brief Use interrupts on an IRQ line shared with other devices
+ * @details The IRQ outputs are open-drain and can be wired-OR. The owner of
+ * the line (e.g. SC16IS7X0_Manager) calls handleInterrupt() on every device
+ * when the line is asserted, a device with nothing pending costs one IIR read.
  */
-#ifndef ESP32
-int SC16IS7X0::read(uint8_t *buffer, size_t len)
-#else
-size_t SC16IS7X0::readBytes(uint8_t *buffer, size_t len)
-#endif
-{
-  size_t a = (size_t)available();
-  if (a < len)
-    len = a;
-
-  if (len == 0)
-    return 0;
+void SC16IS7X0::enableSharedInterrupt(void) {
+  if (_irqPin >= 0)
+    detachInterrupt(digitalPinToInterrupt(_irqPin));
+  _irqPin = -1;
 
-  uint8_t request[1] = {(SC16IS7X0_RHR << 3) | SC16IS7X0_READ_FLAG};
-  busIo->write_then_read(request, 1, buffer, len);
-  return (int)len;
+  startInterruptMode();
 }
 
 /**
- * @brief Check for overrun
+ * @brief Enable the interrupt sources served by handleInterrupt()
  *
- * @return true overrun has occured
- * @return false no overrun
  */
-bool SC16IS7X0::hasOverrun(void) {
-  uint8_t request[1] = {(SC16IS7X0_LSR << 3) | SC16IS7X0_READ_FLAG};
-  uint8_t lsr;
-  busIo->write_then_read(request, 1, &lsr, 1);
-
-  return (lsr & 0x02) ? true : false;
+void SC16IS7X0::startInterruptMode(void) {
+  _irqMode = true;
+
+  // IER[0] RHR interrupt, IER[2] Receive Line Status interrupt, IER[1] THR
+  // interrupt while the software TX buffer is not empty, IER[5] XOFF interrupt
+  // with software flow control
+  _regs.update(Regs::IER, 0x01 | 0x04, true);
+  _regs.update(Regs::IER, 0x02, !_txBuf.empty());
+  _txArmed = true;
+  _irqServiceUs = micros();
+  _regs.update(Regs::IER, 0x20,
+               (_regs.get(Regs::EFR) & 0x03) != 0 || _delimiter >= 0);
+  commitRegisters();
+
+  // Input changes were not tracked while polling
+  _ioValid = false;
+  // The IRQ pin may already be low, no edge would be seen
+  _irqPending = true;
+  _rxHeld = false;
 }
 
 /**
- * @brief Check for error on reception
+ * @brief Go back to polled mode
  *
- * @return true At least one parity error, framing error, or break indication is
- * in the receiver FIFO
- * @return false No error in FIFO
  */
-bool SC16IS7X0::hasRxError(void) {
-  uint8_t request[1] = {(SC16IS7X0_LSR << 3) | SC16IS7X0_READ_FLAG};
-  uint8_t lsr;
-  busIo->write_then_read(request, 1, &lsr, 1);
+void SC16IS7X0::disableInterrupt(void) {
+  if (!_irqMode)
+    return;
 
-  return (lsr & 0x80) ? true : false;
+  if (_irqPin >= 0)
+    detachInterrupt(digitalPinToInterrupt(_irqPin));
+  _irqPin = -1;
+  _irqMode = false;
+  _irqPending = false;
+
+  _regs.update(Regs::IER, 0x01 | 0x02 | 0x04 | 0x20, false);
+  commitRegisters();
 }
 
 /**
- * @brief Enable Hardware CTS Flow control
- * Transmission will stop when a high signal is detected on the CTS pin
+ * @brief Serve the interrupt sources until the IRQ pin is released
+ * @details Performs bus transactions, do not call it from an ISR. It is called
+ * automatically by available(), read() and peek() when an interrupt is
+ * pending, call it from the main loop or a task to drain the RX FIFO earlier.
  *
+ * @return true if the device had at least one interrupt pending
  */
-void SC16IS7X0::enableHardwareCTS(void) {
-  uint8_t request[2];
+bool SC16IS7X0::handleInterrupt(void) {
+  bool held = _rxHeld;
+  _irqPending = false;
+  _rxHeld = false;
+  _irqServiceUs = micros();
+  bool served = false;
+  uint32_t edge = _irqStamped ? _irqStamp : micros();
+
+  // Time from the edge to the service, the largest one decays slowly
+  if (_irqStamped) {
+    uint32_t latency = micros() - _irqStamp;
+    if (latency > _irqLatencyUs)
+      _irqLatencyUs = latency;
+    else
+      _irqLatencyUs -= _irqLatencyUs / 64;
+  }
 
-  // Set LCR Register to 0xBF to access Enhanced register set
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = 0xBF;
-  busIo->write(request, 2);
+  // The characters left behind when the software RX buffer was full come
+  // first, IIR would only report them
+  if (held && !_frameGap && !drainRxKnown(_rxLeft)) {
+    _rxHeld = true;
+    _irqPending = true;
+    return false;
+  }
 
-  // Set EFR[7] to enable Hardware CTS
-  _efr |= (0x01 << 7);
-  request[0] = SC16IS7X0_EFR << 3;
-  request[1] = _efr;
-  busIo->write(request, 2);
+  // IIR reports one source at a time, by priority
+  for (uint8_t i = 0; i < 8; i++) {
+    uint8_t iir = readRegister(SC16IS7X0_IIR);
+    if (iir & SC16IS7X0_IIR_NONE) {
+      // Everything served, the next edge starts a new latency measurement
+      _irqStamped = false;
+      if (_autoFlow)
+        tuneFlowControlLevels();
+      if (_autoTrigger)
+        tuneTriggerLevels();
+      return served;
+    }
+    if (!served)
+      _stats.interrupts++;
+    served = true;
+
+    switch (iir & SC16IS7X0_IIR_MASK) {
+    case SC16IS7X0_IIR_RLS:
+      // Cleared by reading LSR, faulty bytes are drained with the others
+      recordLsr(readRegister(SC16IS7X0_LSR));
+      // fall through
+    case SC16IS7X0_IIR_RX_TIMEOUT:
+    case SC16IS7X0_IIR_RHR: {
+      bool timeout = (iir & SC16IS7X0_IIR_MASK) == SC16IS7X0_IIR_RX_TIMEOUT;
+      bool drained;
+      if (!_frameGap)
+        drained = (iir & SC16IS7X0_IIR_MASK) == SC16IS7X0_IIR_RHR
+                      ? drainRxKnown(getRxTriggerLevel())
+                      : drainRxFifo();
+      else if (timeout)
+        // Raised after 4 character times of silence
+        drained = drainRxFifo(
+            0, edge - (uint32_t)((uint64_t)_charTimeNs * 4 / 1000));
+      else
+        // One character left behind guarantees a time-out at the frame end
+        drained = drainRxFifo(1);
+      if (!drained) {
+        // Software buffer is full, retry once the application has read
+        _rxHeld = true;
+        _irqPending = true;
+        return served;
+      }
+      if (_frameGap && timeout) {
+        _lastRxExact = true;
+        if ((int32_t)(micros() - frameDeadline()) >= 0)
+          closeFrame();
+      }
+      break;
+    }
+
+    case SC16IS7X0_IIR_THR: {
+      // The FIFO went below the TX trigger level, the credit is outdated.
+      // Writing THR clears the interrupt, raised again only once the free
+      // space has gone under the trigger level and back above it. While the
+      // transmitter frees that much during a burst, refill, then leave it to
+      // service().
+      fillTxFifo(true);
+      for (uint8_t n = 0; n < 2 && !_txBuf.empty() && !_txArmed; n++)
+        fillTxFifo(true);
+      break;
+    }
+
+    case SC16IS7X0_IIR_IO:
+      // Cleared by reading IOSTATE
+      updatePort(readRegister(SC16IS7X0_IOSTATE));
+      break;
+
+    case SC16IS7X0_IIR_XOFF:
+      // Cleared by reading IIR. Without delimiter, the chip has halted its
+      // transmitter by itself.
+      if (_delimiter < 0) {
+        _stats.xoffs++;
+        break;
+      }
+      // The delimiter is in the RX FIFO, get the frame now
+      _stats.delimiters++;
+      if (!drainRxFifo()) {
+        _rxHeld = true;
+        _irqPending = true;
+        return served;
+      }
+      break;
+
+    default:
+      break;
+    }
+  }
 
-  // Set back LCR Register value
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = _lcr;
-  busIo->write(request, 2);
+  // Still busy, come back on the next call
+  _irqPending = true;
+  return served;
 }
 
 /**
- * @brief Disable Hardware CTS Flow Control
- *
+ * @brief Queue a read of RXLVL, followed by a read of the RX FIFO into the
+ * software RX buffer
+ * @details Asynchronous counterpart of drainRxFifo(), the callbacks run from
+ * SC16IS7X0_BusIo::poll().
  */
-void SC16IS7X0::disableHardwareCTS(void) {
-  uint8_t request[2];
+void SC16IS7X0::requestRx(void) {
+  if (_rxBusy)
+    return;
 
-  // Set LCR Register to 0xBF to access Enhanced register set
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = 0xBF;
-  busIo->write(request, 2);
+  _rxRequest = (SC16IS7X0_RXLVL << 3) | SC16IS7X0_READ_FLAG;
+  _rxOp = {&_rxRequest, 1, &_rxLevel, 1, onRxLevel, this, nullptr};
+  _rxBusy = busIo->submit(&_rxOp);
+  if (_rxBusy)
+    countBus(1, 1);
+}
 
-  // Reset EFR[7] to enable Hardware CTS
-  _efr &= ~(0x01 << 7);
-  request[0] = SC16IS7X0_EFR << 3;
-  request[1] = _efr;
-  busIo->write(request, 2);
+void SC16IS7X0::onRxLevel(void *arg, bool ok) {
+  SC16IS7X0 *self = static_cast<SC16IS7X0 *>(arg);
+  // The read may have waited behind a TX burst in the queue
+  self->updatePollSlack((int32_t)(micros() - self->rxDeadline()));
+
+  size_t len = ok ? self->_rxLevel : 0;
+  if (ok)
+    self->recordRxLevel(len);
+  if (len > self->_rxBuf.free())
+    len = self->_rxBuf.free();
+  if (len > SC16IS7X0_FIFO_SIZE)
+    len = SC16IS7X0_FIFO_SIZE;
+  if (len > self->busIo->maxTransferSize())
+    len = self->busIo->maxTransferSize();
+  self->_rxLeft = (uint8_t)(ok ? self->_rxLevel - len : 0);
+
+  if (len == 0) {
+    self->_rxBusy = false;
+    return;
+  }
 
-  // Set back LCR Register value
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = _lcr;
-  busIo->write(request, 2);
+  self->_rxRequest = (SC16IS7X0_RHR << 3) | SC16IS7X0_READ_FLAG;
+  self->_rxOp.rx = self->_rxData;
+  self->_rxOp.rx_len = len;
+  self->_rxOp.done = onRxData;
+  self->_rxBusy = self->busIo->submit(&self->_rxOp);
+  if (self->_rxBusy)
+    self->countBus(1, len);
 }
 
-/**
- * @brief Enable Hardware RTS Flow control
- * RTS pin goes high when the receiver FIFO 'halt trigger level' is reached
+void SC16IS7X0::onRxData(void *arg, bool ok) {
+  SC16IS7X0 *self = static_cast<SC16IS7X0 *>(arg);
+  if (ok) {
+    self->pushRx(self->_rxData, self->_rxOp.rx_len, micros());
+  }
+  self->_rxBusy = false;
+}
+
+void SC16IS7X0::onTxDone(void *arg, bool ok) {
+  SC16IS7X0 *self = static_cast<SC16IS7X0 *>(arg);
+  if (ok) {
+    self->_txBuf.skip(self->_txOp.tx_len - 1);
+    self->_stats.txBytes += self->_txOp.tx_len - 1;
+  } else
+    self->_txCredit = 0; // Unknown FIFO state, read TXLVL next time
+  self->_txBurstUs = micros() - self->_txFillUs;
+  self->_txBusy = false;
+}
+
+/**
+ * @brief Move the content of the RX FIFO into the software RX buffer
+ *
+ * @param keep Characters to leave in the RX FIFO
+ * @param lastUs Time (micros()) by which the last character was received
+ * @return true The RX FIFO has been drained, but for keep characters
+ * @return false The software RX buffer is full
+ */
+bool SC16IS7X0::drainRxFifo(uint8_t keep, uint32_t lastUs) {
+  size_t rxlvl = readRegister(SC16IS7X0_RXLVL);
+  recordRxLevel(rxlvl);
+  size_t want = rxlvl > keep ? rxlvl - keep : 0;
+  size_t len = want;
+  if (len > _rxBuf.free())
+    len = _rxBuf.free();
+  if (len > SC16IS7X0_FIFO_SIZE)
+    len = SC16IS7X0_FIFO_SIZE;
+
+  size_t got = 0;
+  if (len > 0) {
+    uint8_t data[SC16IS7X0_FIFO_SIZE];
+    got = readFifo(data, len);
+    pushRx(data, got, lastUs);
+  }
+  _rxLeft = (uint8_t)(rxlvl - got);
+
+  return got == want;
+}
+
+/**
+ * @brief Drain the RX FIFO from the interrupt service, starting without an
+ * RXLVL read
+ * @details The characters known to be in the RX FIFO are read right away:
+ * the RX trigger level on the RHR interrupt, those left behind when the
+ * software RX buffer was full. The FIFO is then drained until less than the
+ * trigger level came in meanwhile: IIR would report the RHR interrupt again
+ * otherwise, one more transaction per burst.
+ *
+ * @param known Characters in the RX FIFO
+ * @return true The RX FIFO holds less than the RX trigger level
+ * @return false The software RX buffer is full, or would be by the next
+ * burst
+ */
+bool SC16IS7X0::drainRxKnown(size_t known) {
+  uint32_t lastUs = micros();
+  size_t level = getRxTriggerLevel();
+  size_t len = known < _rxBuf.free() ? known : _rxBuf.free();
+  // Counts as an RXLVL read for the statistics
+  recordRxLevel(known);
+
+  uint8_t data[SC16IS7X0_FIFO_SIZE];
+  size_t got = readFifo(data, len);
+  pushRx(data, got, lastUs);
+  _rxLeft = (uint8_t)(known - got);
+  if (got < known)
+    return false;
+
+  for (;;) {
+    // The next burst would be cut by the full software buffer, one more
+    // transaction: resume once the application has emptied it
+    if (got > _rxBuf.free() && !_rxBuf.empty())
+      return false;
+    uint32_t before = _stats.rxBytes;
+    if (!drainRxFifo())
+      return false;
+    got = _stats.rxBytes - before;
+    if (got < level)
+      return true;
+  }
+}
+
+/**
+ * @brief Append characters read from the RX FIFO to the software RX buffer
+ * @details Counts the frame delimiters, in RAM, for frameAvailable(). With
+ * enableFrameGap(), closes the open frame first if these characters came
+ * after a silence.
+ *
+ * @param lastUs Time (micros()) by which the last character was received
+ */
+void SC16IS7X0::pushRx(const uint8_t *data, size_t len, uint32_t lastUs) {
+  if (_frameGap && len) {
+    // Within a frame the characters are back to back, the first one came at
+    // the latest len - 1 character times before the last one
+    uint32_t first =
+        lastUs - (uint32_t)((uint64_t)_charTimeNs * (len - 1) / 1000);
+    if (_frameLen && (int32_t)(first - _lastRxUs) >= (int32_t)getFrameGapUs())
+      closeFrame();
+  }
+
+  _rxBuf.push(data, len);
+  _stats.rxBytes += len;
+
+  if (_frameGap && len) {
+    _frameLen += len;
+    _lastRxUs = lastUs;
+    _lastRxExact = false;
+    // No room left for the rest, hand over what has been received
+    if (_rxBuf.full())
+      closeFrame();
+  }
+
+  if (_delimiter < 0)
+    return;
+  const uint8_t *end = data + len;
+  while ((data = (const uint8_t *)memchr(data, _delimiter, end - data))) {
+    _framesIn++;
+    data++;
+  }
+}
+
+/**
+ * @brief Clear the counters and the latency histogram
+ *
+ */
+void SC16IS7X0::resetStats(void) {
+  _stats = {};
+}
+
+/**
+ * @brief Account for bus transactions issued by this instance
+ *
+ * @param out Bytes sent, subaddresses included
+ * @param in Bytes read
+ * @param frames Number of transactions
+ */
+void SC16IS7X0::countBus(size_t out, size_t in, size_t frames) {
+  _stats.transactions += frames;
+  _stats.bytesOut += out;
+  _stats.bytesIn += in;
+}
+
+/**
+ * @brief Update the RX statistics with an RXLVL value just read
+ *
+ * @param rxlvl Number of characters waiting in the RX FIFO
+ */
+void SC16IS7X0::recordRxLevel(size_t rxlvl) {
+  uint32_t now = micros();
+  if (_rxPolled && now - _rxPollUs > _stats.maxServiceIntervalUs)
+    _stats.maxServiceIntervalUs = now - _rxPollUs;
+  _rxPollUs = now;
+  _rxPolled = true;
+
+  if (rxlvl > _stats.rxHighWater)
+    _stats.rxHighWater = (uint8_t)rxlvl;
+  if (rxlvl >= SC16IS7X0_FIFO_SIZE)
+    _stats.rxFifoFull++;
+
+  // Above the halt level, only characters sent after RTS went inactive. A
+  // full FIFO may have lost some, count twice as many. Like the IRQ latency,
+  // the estimate follows a larger value at once and decays toward smaller
+  // ones, so that the halt level recovers when the remote stops sooner. There
+  // are only a few readings per halt, it decays by 1/8 of the difference.
+  if (rxFlowControl()) {
+    int over = (int)rxlvl - getRtsHaltLevel();
+    if (rxlvl >= SC16IS7X0_FIFO_SIZE)
+      over *= 2;
+    if (over >= 0) {
+      uint16_t measured = (uint16_t)(over * 64);
+      if (measured > _rtsOvershoot)
+        _rtsOvershoot = measured;
+      else
+        _rtsOvershoot -= (_rtsOvershoot - measured + 7) / 8;
+    }
+  }
+
+  if (rxlvl == 0)
+    return;
+  _stats.drains++;
+
+  // From the IRQ edge if one is pending, from the arrival of the oldest
+  // character otherwise
+  uint32_t latency;
+  if (_irqStamped) {
+    latency = now - _irqStamp;
+    _irqStamped = false;
+  } else {
+    latency = (uint32_t)((uint64_t)_charTimeNs * rxlvl / 1000);
+  }
+
+  uint8_t bucket = latency ? 31 - __builtin_clz(latency) : 0;
+  if (bucket >= SC16IS7X0_LATENCY_BUCKETS)
+    bucket = SC16IS7X0_LATENCY_BUCKETS - 1;
+  _stats.rxLatency[bucket]++;
+}
+
+/**
+ * @brief Count the line status events reported by an LSR value
+ *
+ * @param lsr Line Status Register
+ */
+void SC16IS7X0::recordLsr(uint8_t lsr) {
+  if (lsr & 0x02)
+    _stats.overruns++;
+  // In 9-bit mode, LSR[2] flags an address
+  if ((lsr & 0x04) && !(_regs.get(Regs::EFCR) & 0x01))
+    _stats.parityErrors++;
+  if (lsr & 0x08)
+    _stats.framingErrors++;
+  if (lsr & 0x10)
+    _stats.breaks++;
+}
+
+/**
+ * @brief Send the register writes queued in the shadow
+ *
+ * @return true if the transaction succeeded
+ */
+bool SC16IS7X0::commitRegisters(void) {
+  bool ok = _regs.commit(busIo);
+  // One frame per register
+  countBus(2 * _regs.sent(), 0, _regs.sent());
+  return ok;
+}
+
+/**
+ * @brief Make sure the software RX buffer holds the received characters
+ * @details In interrupt mode the RX FIFO is drained when the IRQ pin has been
+ * asserted. In polled mode the RX FIFO is read ahead, with one RXLVL read and
+ * one RHR burst, only once the software RX buffer is empty. On an
+ * asynchronous bus these are queued, the characters are available on a
+ * later call.
+ */
+void SC16IS7X0::fetchRx(void) {
+  // Filled by the service task
+  if (!ownsBus())
+    return;
+
+  if (_irqMode) {
+    serviceInterrupt();
+  } else if (busIo->isAsync()) {
+    // Completed by a later call, the CPU does not wait for the bus
+    busIo->poll();
+    if (_rxBuf.empty() && rxPollDue(micros()))
+      requestRx();
+  } else if (_rxBuf.empty() && rxPollDue(micros())) {
+    drainRxFifo();
+  }
+}
+
+/**
+ * @brief Serve the interrupt sources if the IRQ pin has been asserted
+ *
+ */
+void SC16IS7X0::serviceInterrupt(void) {
+  if (rxHeld())
+    return;
+  if (_irqPending) {
+    handleInterrupt();
+    return;
+  }
+
+  // No edge for SC16IS7X0_POLL_IDLE_US, one may have been missed: look at
+  // IIR, then at RXLVL and TXLVL as in polled mode
+  if ((int32_t)(micros() - _irqServiceUs) < (int32_t)SC16IS7X0_POLL_IDLE_US)
+    return;
+  handleInterrupt();
+  if (!_rxBuf.full())
+    drainRxFifo(_frameGap ? 1 : 0);
+  fillTxFifo(true);
+}
+
+/**
+ * @brief true while the interrupt service waits for the application: it
+ * stopped on a full software RX buffer, which has not been emptied yet
+ * @details Like the read-ahead of the polled mode. Served as the application
+ * reads, each character would cost a transaction or more.
+ */
+bool SC16IS7X0::rxHeld(void) const { return _rxHeld && !_rxBuf.empty(); }
+
+/**
+ * @brief IRQ pin falling edge, only flags the instance (no bus access here)
+ *
+ */
+void IRAM_ATTR SC16IS7X0::irqHandler(void *arg) {
+  SC16IS7X0 *self = static_cast<SC16IS7X0 *>(arg);
+  self->_irqPending = true;
+  if (!self->_irqStamped) {
+    self->_irqStamp = micros();
+    self->_irqStamped = true;
+  }
+
+#if SC16IS7X0_SERVICE_TASK
+  TaskHandle_t task = self->_task;
+  if (task) {
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(task, &woken);
+    if (woken)
+      portYIELD_FROM_ISR();
+  }
+#endif
+}
+
+/**
+ * @brief true if the caller may access the bus: no service task is running,
+ * or the caller is the service task
+ */
+bool SC16IS7X0::ownsBus(void) const {
+#if SC16IS7X0_SERVICE_TASK
+  TaskHandle_t task = _task;
+  return task == nullptr || task == xTaskGetCurrentTaskHandle();
+#else
+  return true;
+#endif
+}
+
+void SC16IS7X0::wakeServiceTask(void) {
+#if SC16IS7X0_SERVICE_TASK
+  TaskHandle_t task = _task;
+  if (task)
+    xTaskNotifyGive(task);
+#endif
+}
+
+/**
+ * @brief Block the calling task for a tick while the service task works
+ */
+void SC16IS7X0::waitServiceTask(void) {
+#if SC16IS7X0_SERVICE_TASK
+  vTaskDelay(1);
+#else
+  yield();
+#endif
+}
+
+#if SC16IS7X0_SERVICE_TASK
+/**
+ * @brief Hand the device over to a FreeRTOS task
+ * @details The task serves the IRQ pin (woken by a task notification from
+ * the ISR) or polls the FIFOs before they can overrun, and is woken by
+ * write(). available(), read(), peek(), readBytes(), write(),
+ * availableForWrite() and flush() may then be called from any task or core
+ * without locking: RX data goes through a single producer / single consumer
+ * buffer (one reading task), TX data through a multiple producer buffer.
+ * The other methods access the bus, call them between lockBus() and
+ * unlockBus().
+ *
+ * @param stackSize Stack of the task in bytes
+ * @param priority Priority of the task
+ * @param core Core the task is pinned to, tskNO_AFFINITY for any
+ * @return true if the task has been created
+ */
+bool SC16IS7X0::startServiceTask(uint32_t stackSize, UBaseType_t priority,
+                                 BaseType_t core) {
+  if (_task != nullptr || busIo == nullptr)
+    return false;
+
+  if (_busMutex == nullptr)
+    _busMutex = xSemaphoreCreateMutex();
+  if (_busMutex == nullptr)
+    return false;
+
+  // The handle is stored before the task first runs
+  _taskStop = false;
+  return xTaskCreatePinnedToCore(serviceTask, "SC16IS7X0", stackSize, this,
+                                 priority, (TaskHandle_t *)&_task,
+                                 core) == pdPASS;
+}
+
+/**
+ * @brief Stop the service task, the device goes back to the calling task
+ *
+ */
+void SC16IS7X0::stopServiceTask(void) {
+  if (_task == nullptr || _task == xTaskGetCurrentTaskHandle())
+    return;
+
+  _taskStop = true;
+  while (_task != nullptr) {
+    wakeServiceTask();
+    waitServiceTask();
+  }
+}
+
+/**
+ * @brief Block the calling task until data has been received
+ * @details Uses the notification of the calling task. Only one task may read.
+ *
+ * @param timeout Maximum time to wait in ticks
+ * @return true if data is available
+ */
+bool SC16IS7X0::waitAvailable(TickType_t timeout) {
+  if (!_rxBuf.empty() || _task == nullptr)
+    return available() > 0;
+
+  // Register first, then check: data pushed in between notifies us
+  _rxWaiter = xTaskGetCurrentTaskHandle();
+  ulTaskNotifyTake(pdTRUE, 0);
+  if (_rxBuf.empty())
+    ulTaskNotifyTake(pdTRUE, timeout);
+  _rxWaiter = nullptr;
+
+  return !_rxBuf.empty();
+}
+
+/**
+ * @brief Take the bus from the service task, for the methods other than the
+ * Stream interface
+ *
+ * @param timeout Maximum time to wait in ticks
+ * @return true if the bus has been taken (or no service task was started)
+ */
+bool SC16IS7X0::lockBus(TickType_t timeout) {
+  if (_busMutex == nullptr)
+    return true;
+  return xSemaphoreTake(_busMutex, timeout) == pdTRUE;
+}
+
+void SC16IS7X0::unlockBus(void) {
+  if (_busMutex)
+    xSemaphoreGive(_busMutex);
+}
+
+void SC16IS7X0::serviceTask(void *arg) {
+  SC16IS7X0 *self = static_cast<SC16IS7X0 *>(arg);
+
+  while (!self->_taskStop) {
+    ulTaskNotifyTake(pdTRUE, self->serviceTicks());
+
+    xSemaphoreTake(self->_busMutex, portMAX_DELAY);
+    self->service();
+    if (self->_flushing && self->_txBuf.empty()) {
+      uint8_t lsr = self->readRegister(SC16IS7X0_LSR);
+      self->recordLsr(lsr);
+      if (lsr & 0x40)
+        self->_flushing = false;
+    }
+    xSemaphoreGive(self->_busMutex);
+
+    TaskHandle_t waiter = self->_rxWaiter;
+    if (waiter && !self->_rxBuf.empty())
+      xTaskNotifyGive(waiter);
+  }
+
+  self->_task = nullptr;
+  vTaskDelete(nullptr);
+}
+
+/**
+ * @brief Ticks the service task may sleep when nothing wakes it
+ */
+TickType_t SC16IS7X0::serviceTicks(void) const {
+  // Queued transactions and flush() complete from the next pass
+  if (_rxBusy || _txBusy || _flushing)
+    return 1;
+
+  // The IRQ pin wakes the task, the timeout is a safety net. A pending
+  // interrupt left for a full RX buffer is retried every tick.
+  if (_irqMode)
+    return _irqPending ? 1 : pdMS_TO_TICKS(100);
+
+  // Polled: until the next deadline, a delay of n ticks may last up to
+  // n + 1 ticks
+  int32_t us = (int32_t)(nextServiceDeadline() - micros());
+  TickType_t ticks = us > 0 ? pdMS_TO_TICKS(us / 1000) : 0;
+  return ticks > 1 ? ticks - 1 : 1;
+}
+#endif
+
+/**
+ * @brief Return the number of characters available
+ * @details Characters already in the software RX buffer are returned without
+ * bus transaction. Counts the RX FIFO only when the software RX buffer is
+ * empty.
+ *
+ * @return int
+ */
+int SC16IS7X0::available(void) {
+  fetchRx();
+  return (int)_rxBuf.size();
+}
+
+/**
+ * @brief Return the next character without removing it
+ *
+ * @return int The character or -1 if none has been received
+ */
+int SC16IS7X0::peek(void) {
+  fetchRx();
+  return _rxBuf.peek();
+}
+
+/**
+ * @brief Return a single character
+ *
+ * @return int The character or -1 if none has been received
+ */
+int SC16IS7X0::read(void) {
+  fetchRx();
+  return _rxBuf.pop();
+}
+
+/**
+ * @brief Read one or more received bytes
+ *
+ * @param buffer Destination pointer to transfert RX bytes
+ * @param len Number of bytes to read
+ * @return int Return the real size of data that has been read
+ */
+#ifdef ESP8266
+int SC16IS7X0::read(uint8_t *buffer, size_t len)
+#else
+size_t SC16IS7X0::readBytes(uint8_t *buffer, size_t len)
+#endif
+{
+  fetchRx();
+  size_t n = _rxBuf.pop(buffer, len);
+
+  // The software RX buffer has been emptied, read ahead once more
+  if (n < len && !_irqMode && ownsBus() && rxPollDue(micros())) {
+    drainRxFifo();
+    n += _rxBuf.pop(buffer + n, len - n);
+  }
+
+  return n;
+}
+
+/**
+ * @brief Check for overrun
+ * @details LSR is read, the events it reports are counted in stats()
+ *
+ * @return true overrun has occured
+ * @return false no overrun
+ */
+bool SC16IS7X0::hasOverrun(void) {
+  uint8_t lsr = readRegister(SC16IS7X0_LSR);
+  recordLsr(lsr);
+
+  return (lsr & 0x02) ? true : false;
+}
+
+/**
+ * @brief Check for error on reception
+ * @details LSR is read, the events it reports are counted in stats()
+ *
+ * @return true At least one parity error, framing error, or break indication is
+ * in the receiver FIFO
+ * @return false No error in FIFO
+ */
+bool SC16IS7X0::hasRxError(void) {
+  uint8_t lsr = readRegister(SC16IS7X0_LSR);
+  recordLsr(lsr);
+
+  return (lsr & 0x80) ? true : false;
+}
+
+/**
+ * @brief Set the FIFO levels raising the RHR and THR interrupts
+ * @details Programmed in TLR, in steps of 4 characters (FCR offers 8, 16, 56
+ * and 60 only). A high RX level and a high TX level (free spaces) mean fewer
+ * interrupts and longer bursts, but less time to serve them before the RX
+ * FIFO overruns or the TX FIFO runs dry. Characters below the RX level are
+ * still reported by the RX time-out interrupt, after 4 character times of
+ * silence. Call it after begin_UART().
+ *
+ * @param rxLevel Characters in the RX FIFO, 4 to 60
+ * @param txLevel Free spaces in the TX FIFO, 4 to 60
+ */
+void SC16IS7X0::setTriggerLevels(uint8_t rxLevel, uint8_t txLevel) {
+  _regs.set(Regs::TLR, (triggerSteps(rxLevel) << 4) | triggerSteps(txLevel));
+  commitRegisters();
+}
+
+/**
+ * @brief Number of TLR steps of 4 characters for a level, 1 to 15
+ */
+uint8_t SC16IS7X0::triggerSteps(int level) {
+  int steps = level / 4;
+  if (steps < 1)
+    return 1;
+  if (steps > 15)
+    return 15;
+  return (uint8_t)steps;
+}
+
+/**
+ * @brief Characters in the RX FIFO raising the RHR interrupt
+ *
+ * @return uint8_t From TLR[7:4], or from FCR[7:6] if TLR has not been set
+ */
+uint8_t SC16IS7X0::getRxTriggerLevel(void) const {
+  static const uint8_t fcrLevels[4] = {8, 16, 56, 60};
+  uint8_t tlr = _regs.get(Regs::TLR) >> 4;
+  return tlr ? tlr * 4 : fcrLevels[_regs.get(Regs::FCR) >> 6];
+}
+
+/**
+ * @brief Free spaces in the TX FIFO raising the THR interrupt
+ *
+ * @return uint8_t From TLR[3:0], or from FCR[5:4] if TLR has not been set
+ */
+uint8_t SC16IS7X0::getTxTriggerLevel(void) const {
+  static const uint8_t fcrLevels[4] = {8, 16, 32, 56};
+  uint8_t tlr = _regs.get(Regs::TLR) & 0x0F;
+  return tlr ? tlr * 4 : fcrLevels[(_regs.get(Regs::FCR) >> 4) & 0x03];
+}
+
+/**
+ * @brief Let the interrupt service pick the trigger levels
+ * @details After each interrupt, the levels are set so that the FIFO keeps
+ * enough room (RX) or data (TX) for twice the longest IRQ to service latency
+ * measured recently, plus 4 characters. Fast baudrates or slow hosts get low
+ * levels, slow baudrates or fast hosts high levels and fewer interrupts.
+ * The latency is measured from the edge seen by the ISR of enableInterrupt(),
+ * the levels are set once it has been measured.
+ *
+ * @param maxDelayUs Longest time a received character may wait for the RHR
+ * interrupt while data keeps arriving, bounds the RX level. 0 for no bound.
+ */
+void SC16IS7X0::enableAutoTriggerLevels(uint32_t maxDelayUs) {
+  _autoTrigger = true;
+  _autoMaxDelayUs = maxDelayUs;
+}
+
+void SC16IS7X0::disableAutoTriggerLevels(void) { _autoTrigger = false; }
+
+/**
+ * @brief Levels of enableAutoTriggerLevels(), TLR is only written when they
+ * change
+ */
+void SC16IS7X0::tuneTriggerLevels(void) {
+  if (_irqLatencyUs == 0 || _charTimeNs == 0)
+    return;
+
+  // Characters received or sent while the interrupt waits for service
+  int headroom =
+      (int)((2ULL * _irqLatencyUs * 1000 + _charTimeNs - 1) / _charTimeNs) + 4;
+  int level = SC16IS7X0_FIFO_SIZE - headroom;
+
+  int rxLevel = level;
+  if (_autoMaxDelayUs) {
+    int delayed = (int)((uint64_t)_autoMaxDelayUs * 1000 / _charTimeNs);
+    if (delayed < rxLevel)
+      rxLevel = delayed;
+  }
+  // RTS would stop the remote before the RHR interrupt is raised
+  if (rxFlowControl() && rxLevel >= getRtsHaltLevel())
+    rxLevel = getRtsHaltLevel() - 4;
+
+  _regs.set(Regs::TLR, (triggerSteps(rxLevel) << 4) | triggerSteps(level));
+  commitRegisters();
+}
+
+/**
+ * @brief Enable Hardware CTS Flow control
+ * Transmission will stop when a high signal is detected on the CTS pin
+ *
+ */
+void SC16IS7X0::enableHardwareCTS(void) {
+  // Set EFR[7] to enable Hardware CTS
+  _regs.update(Regs::EFR, 0x01 << 7, true);
+  commitRegisters();
+}
+
+/**
+ * @brief Disable Hardware CTS Flow Control
+ *
+ */
+void SC16IS7X0::disableHardwareCTS(void) {
+  // Reset EFR[7] to disable Hardware CTS
+  _regs.update(Regs::EFR, 0x01 << 7, false);
+  commitRegisters();
+}
+
+/**
+ * @brief Enable Hardware RTS Flow control
+ * RTS pin goes high when the receiver FIFO 'halt trigger level' is reached
  * RTS pin goes low when the 'resume transmission trigger level' is reached
+ * The levels are those of setFlowControlLevels(), 40 and 8 characters if they
+ * have not been set.
  *
  */
 void SC16IS7X0::enableHardwareRTS(void) {
-  uint8_t request[2];
+  initFlowControlLevels();
+
+  // Set EFR[6] to enable Hardware RTS
+  _regs.update(Regs::EFR, 0x01 << 6, true);
+  commitRegisters();
+}
+
+/**
+ * @brief Disable Hardware RTS Flow Control
+ *
+ */
+void SC16IS7X0::disableHardwareRTS(void) {
+  // Reset EFR[6] to disable Hardware RTS
+  _regs.update(Regs::EFR, 0x01 << 6, false);
+  commitRegisters();
+}
+
+/**
+ * @brief RS-485 automatic direction control
+ * @details The chip drives RTS as the transmit enable of the transceiver:
+ * asserted as soon as a character is in the TX FIFO, released right after the
+ * stop bit of the last one. No GPIO nor software timing is involved in the
+ * turnaround. Hardware RTS flow control must not be enabled at the same time.
+ *
+ * @param highOnTx true for RTS high while transmitting (DE input of most
+ * transceivers), false for RTS low
+ */
+void SC16IS7X0::enableRS485(bool highOnTx) {
+  // EFCR[4] RTS controlled by the transmitter, EFCR[5] inverts it
+  _regs.update(Regs::EFCR, 0x10, true);
+  _regs.update(Regs::EFCR, 0x20, highOnTx);
+  commitRegisters();
+}
+
+/**
+ * @brief Give RTS back to the flow control or to the application
+ *
+ */
+void SC16IS7X0::disableRS485(void) {
+  _regs.update(Regs::EFCR, 0x10 | 0x20, false);
+  commitRegisters();
+}
+
+/**
+ * @brief Enable the 9-bit multidrop mode
+ * @details The parity bit becomes the 9th bit, set on address characters and
+ * cleared on data characters. The line must be configured with 8 data bits,
+ * the parity of begin_UART() is replaced. Call it after begin_UART().
+ *
+ * With an address, the chip discards every character until it receives that
+ * address, then passes the address and the following data until another
+ * address arrives: only the frames sent to this node reach the software
+ * buffers. Without address, every character is received and addresses are
+ * flagged by LSR[2], they are not counted as parity errors.
+ *
+ * The address is compared with XOFF2, which is not available to the software
+ * flow control meanwhile.
+ *
+ * @param address Address of this node, -1 to receive every frame (master)
+ */
+void SC16IS7X0::enableMultidrop(int16_t address) {
+  // LCR[5:3] = 111, parity forced to 0 on data characters
+  _regs.update(Regs::LCR, 0x08 | 0x10 | 0x20, true);
+  if (address >= 0)
+    _regs.set(Regs::XOFF2, (uint8_t)address);
+  // EFR[5] automatic address detection
+  _regs.update(Regs::EFR, 0x01 << 5, address >= 0);
+  // EFCR[0] 9-bit mode
+  _regs.update(Regs::EFCR, 0x01, true);
+  commitRegisters();
+}
+
+/**
+ * @brief Back to 8-bit characters without parity
+ *
+ */
+void SC16IS7X0::disableMultidrop(void) {
+  _regs.update(Regs::EFCR, 0x01, false);
+  _regs.update(Regs::EFR, 0x01 << 5, false);
+  _regs.update(Regs::LCR, 0x08 | 0x10 | 0x20, false);
+  commitRegisters();
+}
+
+/**
+ * @brief Send an address character (9th bit set) in multidrop mode
+ * @details Waits for the end of the data written before, since the 9th bit
+ * is set for the whole line (LCR[4]), then for the address to be sent. The
+ * data written afterwards goes to that node.
+ *
+ * @param address Node address
+ * @return true if the address has been written to the TX FIFO
+ */
+bool SC16IS7X0::writeAddress(uint8_t address) {
+  if (busIo == nullptr || !(_regs.get(Regs::EFCR) & 0x01))
+    return false;
+
+  flush();
+  // LCR[5:3] = 101, parity forced to 1
+  _regs.update(Regs::LCR, 0x10, false);
+  commitRegisters();
+  bool ok = writeFifo(&address, 1) == 1;
+  if (ok) {
+    _stats.txBytes++;
+    if (_txCredit)
+      _txCredit--;
+  }
+  flush();
+  _regs.update(Regs::LCR, 0x10, true);
+  commitRegisters();
+  return ok;
+}
+
+/**
+ * @brief Interrupt on a frame delimiter
+ * @details Programs the special character detect (EFR[5], XOFF2): in
+ * interrupt mode, the chip interrupts as soon as the delimiter is received,
+ * whatever the RX trigger level, and the RX FIFO is drained at once. With a
+ * high RX trigger level (setTriggerLevels()), the host is then woken about
+ * once per message. The delimiters are counted as the characters enter the
+ * software RX buffer, so frameAvailable() and readFrame() cost no bus
+ * transaction. Characters already buffered are not counted.
+ *
+ * XOFF2 is shared with the 9-bit address detection and the software flow
+ * control, enable only one of them. With both the delimiter and the XON /
+ * XOFF software flow control, an XOFF interrupt is taken for a delimiter.
+ *
+ * Replaces enableFrameGap().
+ *
+ * @param delimiter Last character of each frame, e.g. '\n' or ETX (0x03)
+ */
+void SC16IS7X0::enableFrameDelimiter(uint8_t delimiter) {
+  _frameGap = false;
+  _delimiter = delimiter;
+  _framesOut = _framesIn;
+
+  _regs.set(Regs::XOFF2, delimiter);
+  // EFR[5] special character detect, IER[5] its interrupt
+  _regs.update(Regs::EFR, 0x01 << 5, true);
+  _regs.update(Regs::IER, 0x20, _irqMode);
+  commitRegisters();
+}
+
+/**
+ * @brief Stop interrupting on the frame delimiter
+ *
+ */
+void SC16IS7X0::disableFrameDelimiter(void) {
+  _delimiter = -1;
+  _regs.update(Regs::EFR, 0x01 << 5, false);
+  _regs.update(Regs::IER, 0x20, (_regs.get(Regs::EFR) & 0x03) != 0);
+  commitRegisters();
+}
+
+/**
+ * @brief Split the received characters into frames at silences on the line
+ * @details For protocols like Modbus RTU, a frame ends when the line stays
+ * silent for 3.5 character times, computed from the baudrate and the
+ * character format of begin_UART(). The end of a frame is seen:
+ * - in interrupt mode, from the RX time-out interrupt, raised 4 character
+ *   times after the last character. The RX FIFO is drained but for one
+ *   character so that the time-out always follows. Frames closer than 4
+ *   character times but further than the gap may be merged.
+ * - in polled mode, from service(), which reads RXLVL once the gap has
+ *   elapsed since the last characters were read and closes the frame if
+ *   nothing came in. The characters are dated when read,
+ *   nextServiceDeadline() includes the end of the open frame. Characters
+ *   found later than that are split off if, back to back, they cannot have
+ *   followed the previous ones within the gap.
+ * readFrame() then returns whole frames with the time their last character
+ * was received. Up to SC16IS7X0_FRAME_QUEUE frames are kept apart in the
+ * software RX buffer, a frame filling it is split. Replaces
+ * enableFrameDelimiter().
+ *
+ * @param minGapUs Shortest silence, e.g. 1750 for Modbus RTU above 19200
+ * baud. 0 for 3.5 character times.
+ */
+void SC16IS7X0::enableFrameGap(uint32_t minGapUs) {
+  if (_delimiter >= 0)
+    disableFrameDelimiter();
+  _frameGap = true;
+  _frameMinGapUs = minGapUs;
+  _frameLen = 0;
+  _framesOut = _framesIn;
+}
+
+void SC16IS7X0::disableFrameGap(void) { _frameGap = false; }
+
+/**
+ * @brief Silence ending a frame with enableFrameGap()
+ *
+ * @return uint32_t The largest of 3.5 character times and minGapUs
+ */
+uint32_t SC16IS7X0::getFrameGapUs(void) const {
+  uint32_t gap = (uint32_t)((uint64_t)_charTimeNs * 7 / 2000);
+  return gap > _frameMinGapUs ? gap : _frameMinGapUs;
+}
+
+/**
+ * @brief Whether the open frame waits for frameDeadline()
+ * @details In interrupt mode, a character is left in the RX FIFO until the
+ * RX time-out interrupt dates the end of the frame.
+ */
+bool SC16IS7X0::frameTimed(void) const {
+  return _frameGap && _frameLen && (!_irqMode || _lastRxExact);
+}
+
+/**
+ * @brief Time by which the open frame may be closed
+ */
+uint32_t SC16IS7X0::frameDeadline(void) const {
+  return _lastRxUs + getFrameGapUs();
+}
+
+/**
+ * @brief Close the open frame if the line has been silent for the gap
+ *
+ */
+void SC16IS7X0::checkFrameGap(void) {
+  if (!frameTimed() || !ownsBus())
+    return;
+  if ((int32_t)(micros() - frameDeadline()) < 0)
+    return;
+
+  // Nothing received since, read RXLVL to be sure
+  uint32_t len = _frameLen;
+  if (!_rxBuf.full())
+    drainRxFifo(_irqMode ? 1 : 0);
+  if (_frameLen == len && _rxLeft == 0)
+    closeFrame();
+  else if (_irqMode)
+    _lastRxExact = false; // Wait for the next time-out
+}
+
+/**
+ * @brief Queue the open frame for readFrame()
+ *
+ */
+void SC16IS7X0::closeFrame(void) {
+  // Queue full: the frame stays open and is merged with the next one
+  if (_frameLen == 0 || _framesIn - _framesOut >= SC16IS7X0_FRAME_QUEUE)
+    return;
+
+  Frame &frame = _frameQueue[_framesIn % SC16IS7X0_FRAME_QUEUE];
+  frame.len = _frameLen;
+  frame.endUs = _lastRxUs;
+  _frameLen = 0;
+  _framesIn++;
+}
+
+/**
+ * @brief Whether readFrame() has a complete frame to return
+ * @details Also true when the software RX buffer is full of a single frame,
+ * readFrame() then returns a part of it.
+ *
+ * @return true if a delimiter is in the software RX buffer
+ */
+bool SC16IS7X0::frameAvailable(void) {
+  if (_framesIn != _framesOut)
+    return true;
+
+  if (ownsBus()) {
+    if (_irqMode)
+      serviceInterrupt();
+    else if (!_rxBuf.full() && rxPollDue(micros()))
+      drainRxFifo();
+    checkFrameGap();
+  }
+  return _framesIn != _framesOut || (_delimiter >= 0 && _rxBuf.full());
+}
+
+/**
+ * @brief Read one frame, delimiter included
+ * @details Copies from the software RX buffer up to and including the next
+ * delimiter of enableFrameDelimiter(), or the next frame of enableFrameGap().
+ * A frame longer than len is returned over several calls. Returns 0 while no
+ * complete frame has been received, see frameAvailable().
+ *
+ * @param buffer Destination
+ * @param len Size of the destination
+ * @param endUs Set to the micros() time the last character of the frame was
+ * received (enableFrameGap()), may be nullptr
+ * @return size_t Number of characters copied
+ */
+size_t SC16IS7X0::readFrame(uint8_t *buffer, size_t len, uint32_t *endUs) {
+  if ((_delimiter < 0 && !_frameGap) || !frameAvailable())
+    return 0;
+
+  if (_frameGap) {
+    Frame &frame = _frameQueue[_framesOut % SC16IS7X0_FRAME_QUEUE];
+    size_t n = _rxBuf.pop(buffer, len < frame.len ? len : frame.len);
+    frame.len -= n;
+    if (endUs)
+      *endUs = frame.endUs;
+    if (frame.len == 0)
+      _framesOut++;
+    return n;
+  }
+
+  size_t n = _rxBuf.peek(buffer, len);
+  uint8_t *end = (uint8_t *)memchr(buffer, _delimiter, n);
+  if (end != nullptr) {
+    n = end - buffer + 1;
+    _framesOut++;
+  }
+  _rxBuf.skip(n);
+  return n;
+}
 
+/**
+ * @brief Default RTS and XOFF levels, unless setFlowControlLevels() has been
+ * called
+ *
+ */
+void SC16IS7X0::initFlowControlLevels(void) {
   // TCR[7:4] Trigger level to resume transmission (set to 2h = 2x4 -> 8
   // characters) TCR[3:0] Trigger level to halt transmission (set to Ah = 10x4
   // -> 40 characters) TCR[3:0] must be > TCR[7:4]
-  request[0] = SC16IS7X0_TCR << 3;
-  request[1] = 0x2A;
-  busIo->write(request, 2);
+  if (_regs.get(Regs::TCR) == 0)
+    _regs.set(Regs::TCR, 0x2A);
+}
 
-  // Set LCR Register to 0xBF to access Enhanced register set
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = 0xBF;
-  busIo->write(request, 2);
+/**
+ * @brief Whether the chip halts the remote on the TCR levels, with RTS or
+ * with XOFF
+ */
+bool SC16IS7X0::rxFlowControl(void) const {
+  return (_regs.get(Regs::EFR) & (0x40 | 0x0C)) != 0;
+}
 
-  // Set EFR[6] to enable Hardware RTS
-  _efr |= (0x01 << 6);
-  request[0] = SC16IS7X0_EFR << 3;
-  request[1] = _efr;
-  busIo->write(request, 2);
+/**
+ * @brief Set the XON and XOFF characters of the software flow control
+ * @details XON2 / XOFF2 are only used by the modes comparing or transmitting
+ * them, see enableSoftwareFlowControl().
+ *
+ * @param xon1 XON1 character, usually DC1 (0x11)
+ * @param xoff1 XOFF1 character, usually DC3 (0x13)
+ * @param xon2 XON2 character
+ * @param xoff2 XOFF2 character
+ */
+void SC16IS7X0::setXonXoff(uint8_t xon1, uint8_t xoff1, uint8_t xon2,
+                           uint8_t xoff2) {
+  _regs.set(Regs::XON1, xon1);
+  _regs.set(Regs::XOFF1, xoff1);
+  _regs.set(Regs::XON2, xon2);
+  _regs.set(Regs::XOFF2, xoff2);
+  commitRegisters();
+}
+
+/**
+ * @brief Enable the in-chip software flow control
+ * @details The chip strips the XON / XOFF characters received and halts or
+ * resumes its transmitter by itself, the application never sees them. It
+ * transmits XOFF once the RX FIFO reaches the halt level of
+ * setFlowControlLevels() (40 characters by default) and XON once it is down
+ * to the resume level, ahead of the data waiting in the TX FIFO. In interrupt
+ * mode, each XOFF received is counted in Stats::xoffs. XON1 / XOFF1 default
+ * to DC1 (0x11) / DC3 (0x13) if setXonXoff() has not been called.
+ *
+ * @param mode One SC16IS7X0_SWFLOW_TX_* ORed with one SC16IS7X0_SWFLOW_RX_*,
+ * either may be omitted
+ */
+void SC16IS7X0::enableSoftwareFlowControl(uint8_t mode) {
+  if (_regs.get(Regs::XON1) == 0 && _regs.get(Regs::XOFF1) == 0) {
+    _regs.set(Regs::XON1, 0x11);
+    _regs.set(Regs::XOFF1, 0x13);
+  }
+  initFlowControlLevels();
 
-  // Set back LCR Register value
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = _lcr;
-  busIo->write(request, 2);
+  // EFR[3:0] software flow control mode
+  _regs.set(Regs::EFR, (_regs.get(Regs::EFR) & ~0x0F) | (mode & 0x0F));
+  // IER[5] XOFF interrupt
+  _regs.update(Regs::IER, 0x20, _irqMode && (mode & 0x03));
+  commitRegisters();
 }
 
 /**
- * @brief Disable Hardware RTS Flow Control
+ * @brief Disable the in-chip software flow control
  *
  */
-void SC16IS7X0::disableHardwareRTS(void) {
-  uint8_t request[2];
+void SC16IS7X0::disableSoftwareFlowControl(void) {
+  _regs.update(Regs::EFR, 0x0F, false);
+  _regs.update(Regs::IER, 0x20, false);
+  commitRegisters();
+}
+
+/**
+ * @brief Set the RX FIFO levels driving RTS and XOFF / XON
+ * @details Programmed in TCR, in steps of 4 characters. RTS goes inactive (or
+ * XOFF is sent) once the RX FIFO holds haltLevel characters, and active again
+ * (XON) once it is down to resumeLevel. The remote only stops after the character in progress
+ * and its own reaction time, the FIFO must have room for them above
+ * haltLevel. Keep the RX trigger level below haltLevel, otherwise only the RX
+ * time-out interrupt reports the halted FIFO. Call it after begin_UART().
+ *
+ * @param haltLevel Characters in the RX FIFO, 8 to 60
+ * @param resumeLevel Characters in the RX FIFO, 0 to haltLevel - 4
+ */
+void SC16IS7X0::setFlowControlLevels(uint8_t haltLevel, uint8_t resumeLevel) {
+  uint8_t halt = triggerSteps(haltLevel);
+  if (halt < 2)
+    halt = 2;
+  // TCR[3:0] must be > TCR[7:4]
+  uint8_t resume = resumeLevel / 4;
+  if (resume >= halt)
+    resume = halt - 1;
+  _regs.set(Regs::TCR, (resume << 4) | halt);
+  commitRegisters();
+}
+
+/**
+ * @brief Characters in the RX FIFO making RTS inactive
+ *
+ * @return uint8_t From TCR[3:0], 40 if TCR has not been set
+ */
+uint8_t SC16IS7X0::getRtsHaltLevel(void) const {
+  uint8_t tcr = _regs.get(Regs::TCR);
+  return tcr ? (tcr & 0x0F) * 4 : 40;
+}
 
-  // Set LCR Register to 0xBF to access Enhanced register set
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = 0xBF;
-  busIo->write(request, 2);
+/**
+ * @brief Characters in the RX FIFO making RTS active again
+ *
+ * @return uint8_t From TCR[7:4], 8 if TCR has not been set
+ */
+uint8_t SC16IS7X0::getRtsResumeLevel(void) const {
+  uint8_t tcr = _regs.get(Regs::TCR);
+  return tcr ? (tcr >> 4) * 4 : 8;
+}
 
-  // Reset EFR[6] to enable Hardware RTS
-  _efr &= ~(0x01 << 6);
-  request[0] = SC16IS7X0_EFR << 3;
-  request[1] = _efr;
-  busIo->write(request, 2);
+/**
+ * @brief Let the driver pick the RTS levels
+ * @details After each drain, the halt level leaves room in the RX FIFO for
+ * the characters the remote sends once RTS is inactive, plus 4. They are
+ * measured as the largest RX level seen above the halt level, which slowly
+ * decays toward the smaller levels seen later. Until the remote has been
+ * halted once, the characters received during the drain latency stand in
+ * for them: the IRQ to service latency measured by the ISR in interrupt mode,
+ * the lateness of service() calls past nextServiceDeadline() in polled mode.
+ * Fast hosts and remotes quick to stop thus use nearly the whole FIFO, slow
+ * hosts halt the remote early. The resume level is the halt level minus the
+ * same headroom. Enable hardware RTS with enableHardwareRTS().
+ */
+void SC16IS7X0::enableAutoFlowControlLevels(void) {
+  _autoFlow = true;
+  _rtsOvershoot = 0;
+}
+
+void SC16IS7X0::disableAutoFlowControlLevels(void) { _autoFlow = false; }
+
+/**
+ * @brief Levels of enableAutoFlowControlLevels(), TCR is only written when
+ * they change
+ */
+void SC16IS7X0::tuneFlowControlLevels(void) {
+  if (_charTimeNs == 0)
+    return;
+
+  int headroom = (_rtsOvershoot + 63) / 64;
+  if (headroom == 0) {
+    uint32_t latency = _irqMode ? _irqLatencyUs : _pollSlackUs;
+    headroom =
+        (int)(((uint64_t)latency * 1000 + _charTimeNs - 1) / _charTimeNs);
+  }
+  headroom += 4;
 
-  // Set back LCR Register value
-  request[0] = SC16IS7X0_LCR << 3;
-  request[1] = _lcr;
-  busIo->write(request, 2);
+  int halt = SC16IS7X0_FIFO_SIZE - headroom;
+  if (halt < 8)
+    halt = 8;
+  int resume = halt - headroom;
+  setFlowControlLevels(halt, resume < 0 ? 0 : resume);
 }
 
 /**
@@ -625,11 +2413,7 @@ void SC16IS7X0::pinMode(uint8_t pin, uint8_t mode) {
 
   switch (mode) {
   case OUTPUT:
-    _ioDir |= 0x01 << pin;
-    break;
-
   case INPUT:
-    _ioDir &= ~(0x01 << pin);
     break;
 
   default:
@@ -637,8 +2421,8 @@ void SC16IS7X0::pinMode(uint8_t pin, uint8_t mode) {
   }
 
   // Write IoDir Register
-  const uint8_t request[2] = {(SC16IS7X0_IODIR << 3), _ioDir};
-  busIo->write(request, 2);
+  _regs.update(Regs::IODIR, 0x01 << pin, mode == OUTPUT);
+  commitRegisters();
 }
 
 /**
@@ -650,14 +2434,9 @@ void SC16IS7X0::pinMode(uint8_t pin, uint8_t mode) {
 void SC16IS7X0::digitalWrite(uint8_t pin, uint8_t val) {
   assert(pin <= 7);
 
-  if (val != 0)
-    _ioState |= 0x01 << pin;
-  else
-    _ioState &= ~(0x01 << pin);
-
   // Write IoState Register
-  const uint8_t request[2] = {(SC16IS7X0_IOSTATE << 3), _ioState};
-  busIo->write(request, 2);
+  _regs.update(Regs::IOSTATE, 0x01 << pin, val != 0);
+  commitRegisters();
 }
 
 /**
@@ -669,8 +2448,189 @@ void SC16IS7X0::digitalWrite(uint8_t pin, uint8_t val) {
 int SC16IS7X0::digitalRead(uint8_t pin) {
   assert(pin <= 7);
 
-  const uint8_t request[2] = {(SC16IS7X0_IOSTATE << 3) | SC16IS7X0_READ_FLAG};
-  uint8_t data;
-  busIo->write_then_read(request, 1, &data, 1);
+  uint8_t data = portCached(0x01 << pin) ? _ioInputs : refreshPort();
   return data & (0x01 << pin) ? 1 : 0;
+}
+
+/**
+ * @brief Set the direction of all the pins in one write
+ *
+ * @param outputs Bit n set for pin n as output, cleared for input (IODIR)
+ */
+void SC16IS7X0::setPortDirection(uint8_t outputs) {
+  _regs.set(Regs::IODIR, outputs);
+  commitRegisters();
+}
+
+/**
+ * @brief Write several output pins in one write
+ *
+ * @param mask Pins to change, bit n for pin n
+ * @param value Their new levels
+ */
+void SC16IS7X0::writePort(uint8_t mask, uint8_t value) {
+  uint8_t iostate = _regs.get(Regs::IOSTATE);
+  _regs.set(Regs::IOSTATE, (iostate & ~mask) | (value & mask));
+  commitRegisters();
+}
+
+/**
+ * @brief Levels of all the pins
+ * @details Outputs come from the last writes. In interrupt mode, the inputs
+ * enabled in IOINTENA (setPortInterrupt(), attachPinChange()) are refreshed
+ * by the I/O interrupt only, when all the inputs are, no bus transaction is
+ * issued. Otherwise IOSTATE is read, see refreshPort().
+ *
+ * @return uint8_t Bit n for pin n
+ */
+uint8_t SC16IS7X0::readPort(void) {
+  uint8_t inputs = ~_regs.get(Regs::IODIR);
+  uint8_t data = portCached(inputs) ? _ioInputs : refreshPort();
+  return (data & inputs) | (_regs.get(Regs::IOSTATE) & ~inputs);
+}
+
+/**
+ * @brief Read IOSTATE into the input snapshot
+ * @details Runs the change callbacks of the pins found changed.
+ *
+ * @return uint8_t IOSTATE
+ */
+uint8_t SC16IS7X0::refreshPort(void) {
+  uint8_t iostate = readRegister(SC16IS7X0_IOSTATE);
+  updatePort(iostate);
+  return iostate;
+}
+
+/**
+ * @brief Pins whose changes raise the I/O interrupt
+ * @details Seeds the input snapshot, which these pins then no longer read
+ * from the bus in interrupt mode. A change on an input of the mask is served
+ * by handleInterrupt() with one IOSTATE read for the whole port.
+ *
+ * @param mask Bit n for pin n (IOINTENA)
+ */
+void SC16IS7X0::setPortInterrupt(uint8_t mask) {
+  _regs.set(Regs::IOINTENA, mask);
+  commitRegisters();
+  refreshPort();
+}
+
+/**
+ * @brief Run a function when an input pin changes
+ * @details Enables the I/O interrupt of the pin. The callback runs from
+ * handleInterrupt(), service() or the service task in interrupt mode, and
+ * from the call reading IOSTATE (digitalRead(), readPort(), refreshPort())
+ * otherwise. Changes shorter than the interrupt latency may be missed.
+ *
+ * @param pin Pin number from 0 to 7
+ * @param callback Function to run, with arg
+ * @param arg Passed to the callback
+ */
+void SC16IS7X0::attachPinChange(uint8_t pin, PinChangeCallback callback,
+                                void *arg) {
+  assert(pin <= 7);
+
+  _pinChange[pin] = {callback, arg};
+  setPortInterrupt(_regs.get(Regs::IOINTENA) | 0x01 << pin);
+}
+
+/**
+ * @brief Stop running the function of attachPinChange()
+ *
+ * @param pin Pin number from 0 to 7
+ */
+void SC16IS7X0::detachPinChange(uint8_t pin) {
+  assert(pin <= 7);
+
+  _pinChange[pin] = {nullptr, nullptr};
+  _regs.update(Regs::IOINTENA, 0x01 << pin, false);
+  commitRegisters();
+}
+
+/**
+ * @brief Clock a sequence of levels out of the output pins
+ * @details The subaddress does not auto-increment: the values are written
+ * to IOSTATE back to back in one transaction (or in the largest chunks the
+ * transport accepts), one every getPortSamplePeriodNs(). Inputs ignore their
+ * bits. Suited to shift registers or LED strips whose timing follows the
+ * data rather than a clock.
+ *
+ * @param values IOSTATE values, in order
+ * @param len Number of values
+ * @return size_t Number of values written, less than len after a bus error
+ */
+size_t SC16IS7X0::writePortSequence(const uint8_t *values, size_t len) {
+  // Pending shadow writes go first, IOSTATE is then known to the shadow
+  commitRegisters();
+  uint32_t start = micros();
+  size_t done = writeFifo(values, len, SC16IS7X0_IOSTATE);
+  if (done == 0)
+    return 0;
+
+  _portSampleNs = (uint32_t)((uint64_t)(micros() - start) * 1000 / done);
+  _regs.record(Regs::IOSTATE, values[done - 1]);
+  return done;
+}
+
+/**
+ * @brief Sample the pins at the bus rate
+ * @details IOSTATE is read back to back in one transaction (or in the
+ * largest chunks the transport accepts), one sample every
+ * getPortSamplePeriodNs(). The last sample updates the input snapshot of
+ * readPort().
+ *
+ * @param values Destination, one IOSTATE value per sample
+ * @param len Number of samples
+ * @return size_t Number of samples read, less than len after a bus error
+ */
+size_t SC16IS7X0::readPortSequence(uint8_t *values, size_t len) {
+  uint32_t start = micros();
+  size_t done = readFifo(values, len, SC16IS7X0_IOSTATE);
+  if (done == 0)
+    return 0;
+
+  _portSampleNs = (uint32_t)((uint64_t)(micros() - start) * 1000 / done);
+  updatePort(values[done - 1]);
+  return done;
+}
+
+/**
+ * @brief Time between two samples of writePortSequence() and
+ * readPortSequence()
+ * @details Measured by the last sequence, transaction overheads included.
+ * Before, estimated from the SPI clock of begin_SPI() (8 clocks per sample),
+ * 0 on the other buses. On I2C this is an average: the samples are evenly
+ * spaced within one chunk of the transport (e.g. the Wire buffer) only.
+ *
+ * @return uint32_t Period in nanoseconds
+ */
+uint32_t SC16IS7X0::getPortSamplePeriodNs(void) const {
+  if (_portSampleNs)
+    return _portSampleNs;
+  return _spiFreq ? (uint32_t)(8000000000ULL / _spiFreq) : 0;
+}
+
+/**
+ * @brief Whether the input snapshot is up to date for these pins
+ *
+ */
+bool SC16IS7X0::portCached(uint8_t mask) const {
+  return _irqMode && _ioValid && (mask & ~_regs.get(Regs::IOINTENA)) == 0;
+}
+
+/**
+ * @brief Store an IOSTATE read and run the callbacks of the changed inputs
+ *
+ */
+void SC16IS7X0::updatePort(uint8_t iostate) {
+  uint8_t changed = _ioValid ? (iostate ^ _ioInputs) : 0;
+  changed &= ~_regs.get(Regs::IODIR);
+  _ioInputs = iostate;
+  _ioValid = true;
+
+  for (uint8_t pin = 0; changed; pin++, changed >>= 1) {
+    if ((changed & 0x01) && _pinChange[pin].callback)
+      _pinChange[pin].callback(_pinChange[pin].arg, pin,
+                               iostate & (0x01 << pin) ? 1 : 0);
+  }
 }
\ No newline at end of file
@@ -7,24 +7,142 @@
 
 #include "Stream.h"
 #include "SC16IS7X0_defines.h"
+#include "SC16IS7X0_BaudPlan.h"
 #include "SC16IS7X0_BusIo.h"
+#include "SC16IS7X0_Registers.h"
+#include "SC16IS7X0_RingBuffer.h"
+
+// Size of the software RX buffer filled from the RX FIFO (power of two)
+#ifndef SC16IS7X0_RX_BUFFER_SIZE
+#define SC16IS7X0_RX_BUFFER_SIZE 256
+#endif
+
+// Size of the software TX buffer behind write() (power of two)
+#ifndef SC16IS7X0_TX_BUFFER_SIZE
+#define SC16IS7X0_TX_BUFFER_SIZE 256
+#endif
+
+// Buckets of the RX latency histogram of SC16IS7X0::Stats, bucket i counts
+// the latencies of [2^i, 2^(i+1)) microseconds, the last one the longer ones
+#ifndef SC16IS7X0_LATENCY_BUCKETS
+#define SC16IS7X0_LATENCY_BUCKETS 16
+#endif
+
+// Characters of the RX FIFO kept free by the poll scheduler, they cover the
+// time needed to read RXLVL and start the RX burst
+#ifndef SC16IS7X0_POLL_RESERVE
+#define SC16IS7X0_POLL_RESERVE 8
+#endif
+
+// Interrupt mode: longest time without an interrupt served before service()
+// reads IIR, RXLVL and TXLVL anyway, safety net against a missed edge
+#ifndef SC16IS7X0_POLL_IDLE_US
+#define SC16IS7X0_POLL_IDLE_US 100000
+#endif
+
+// Frames delimited by silence (enableFrameGap()) waiting in the software RX
+// buffer for readFrame(), a boundary is dropped when more are waiting
+#ifndef SC16IS7X0_FRAME_QUEUE
+#define SC16IS7X0_FRAME_QUEUE 8
+#endif
+
+// Service task support: a FreeRTOS task owns the device and the bus, the
+// Stream methods may then be called from any task or core
+#ifndef SC16IS7X0_SERVICE_TASK
+#ifdef ESP32
+#define SC16IS7X0_SERVICE_TASK 1
+#else
+#define SC16IS7X0_SERVICE_TASK 0
+#endif
+#endif
+
+#if SC16IS7X0_SERVICE_TASK
+#include "SC16IS7X0_MpscRingBuffer.h"
+#endif
 
 class SC16IS7X0 : public Stream
 {
 public:
+  /**
+   * @brief Counters kept by each instance, updated without bus transaction
+   * @details The line status events are counted when LSR is read: receiver
+   * line status interrupt, hasOverrun() and hasRxError(). In polled mode
+   * without these calls, rxFifoFull tells that characters may have been lost.
+   */
+  struct Stats {
+    uint32_t transactions;  // Bus transactions issued by this instance
+    uint32_t bytesOut;      // Subaddresses and data sent on the bus
+    uint32_t bytesIn;       // Data read on the bus
+    uint32_t rxBytes;       // Characters read from the RX FIFO
+    uint32_t txBytes;       // Characters written into the TX FIFO
+    uint32_t overruns;      // LSR[1]
+    uint32_t parityErrors;  // LSR[2]
+    uint32_t framingErrors; // LSR[3]
+    uint32_t breaks;        // LSR[4]
+    uint32_t rxFifoFull;    // RX FIFO found full (64 characters)
+    uint8_t rxHighWater;    // Highest RXLVL read
+    uint32_t txStarved;     // TX FIFO found empty while data was waiting
+    uint32_t drains;        // RX FIFO reads with characters waiting
+    uint32_t interrupts;    // handleInterrupt() calls finding a source
+    uint32_t xoffs;         // XOFF interrupts (software flow control)
+    uint32_t delimiters;    // Frame delimiter interrupts
+    uint32_t maxServiceIntervalUs; // Longest time between two RX FIFO visits
+    // Time from the IRQ edge to the RX FIFO drain or, without IRQ pin, age of
+    // the oldest character drained (RXLVL character times)
+    uint32_t rxLatency[SC16IS7X0_LATENCY_BUCKETS];
+  };
+
   SC16IS7X0(uint32_t crystalClock);
-  virtual ~SC16IS7X0() {}
+  virtual ~SC16IS7X0();
 
-  bool begin_SPI(uint8_t cs_pin, SPIClass *theSPI = &SPI);
+  bool begin_SPI(uint8_t cs_pin, SPIClass *theSPI = &SPI,
+                 uint32_t freq = 4000000, uint8_t dataMode = SPI_MODE0);
+#ifdef ESP32
+  bool begin_SPI_DMA(uint8_t cs_pin, int8_t sck, int8_t miso, int8_t mosi,
+                     uint32_t freq = 4000000, uint8_t dataMode = SPI_MODE0,
+                     spi_host_device_t host = SPI2_HOST);
+#endif
   bool begin_I2C(uint8_t addr, TwoWire *theWire = &Wire);
-  void begin_UART(unsigned long baudrate, SerialConfig config = SERIAL_8N1);
+  bool begin(SC16IS7X0_BusIo *theBusIo);
+  bool begin(SC16IS7X0_BusIo &theBusIo);
+  bool begin_UART(unsigned long baudrate, SerialConfig config = SERIAL_8N1,
+                  uint32_t maxErrorPpm = SC16IS7X0_BAUD_TOLERANCE_PPM);
 
-  void updateBaudRate(unsigned long baudrate);
+  uint32_t probeSPIClock(uint32_t maxFreq = 15000000);
+  uint32_t getSPIClock(void) const { return _spiFreq; }
+
+  bool updateBaudRate(unsigned long baudrate,
+                      uint32_t maxErrorPpm = SC16IS7X0_BAUD_TOLERANCE_PPM);
+  const SC16IS7X0_BaudPlan &getBaudPlan(void) const { return _baudPlan; }
+  void updateConfig(SerialConfig config);
+
+  bool enableInterrupt(uint8_t irqPin);
+  void enableSharedInterrupt(void);
+  void disableInterrupt(void);
+  bool isInterruptMode(void) const { return _irqMode; }
+  bool handleInterrupt(void);
+  void service(void);
+  uint32_t nextServiceDeadline(void) const;
+
+  uint32_t getCharTimeNs(void) const { return _charTimeNs; }
+
+  const Stats &stats(void) const { return _stats; }
+  void resetStats(void);
+
+#if SC16IS7X0_SERVICE_TASK
+  bool startServiceTask(uint32_t stackSize = 4096, UBaseType_t priority = 5,
+                        BaseType_t core = tskNO_AFFINITY);
+  void stopServiceTask(void);
+  bool isServiceTaskRunning(void) const { return _task != nullptr; }
+  bool waitAvailable(TickType_t timeout);
+  bool lockBus(TickType_t timeout = portMAX_DELAY);
+  void unlockBus(void);
+#endif
 
   int available(void) override;
-  int peek(void) override { return -1; }
+  int peek(void) override;
   int read(void) override;
-  void flush() override{/*TODO*/};
+  void flush() override;
 
 #ifdef ESP8266
   int read(uint8_t *buffer, size_t len) override;
@@ -34,6 +152,7 @@ public:
 
   size_t write(uint8_t c) override;
   size_t write(const uint8_t *buffer, size_t size) override;
+  int availableForWrite(void) override;
 
   using Print::write; // Import other write() methods to support things like
                       // write(0) properly
@@ -41,11 +160,42 @@ public:
   bool hasOverrun(void);
   bool hasRxError(void);
 
+  void setTriggerLevels(uint8_t rxLevel, uint8_t txLevel);
+  uint8_t getRxTriggerLevel(void) const;
+  uint8_t getTxTriggerLevel(void) const;
+  void enableAutoTriggerLevels(uint32_t maxDelayUs = 0);
+  void disableAutoTriggerLevels(void);
+
   void enableHardwareCTS(void);
   void disableHardwareCTS(void);
 
   void enableHardwareRTS(void);
   void disableHardwareRTS(void);
+  void setFlowControlLevels(uint8_t haltLevel, uint8_t resumeLevel);
+  uint8_t getRtsHaltLevel(void) const;
+  uint8_t getRtsResumeLevel(void) const;
+  void enableAutoFlowControlLevels(void);
+  void disableAutoFlowControlLevels(void);
+
+  void setXonXoff(uint8_t xon1, uint8_t xoff1, uint8_t xon2 = 0x00,
+                  uint8_t xoff2 = 0x00);
+  void enableSoftwareFlowControl(uint8_t mode = SC16IS7X0_SWFLOW_TX_XON1 |
+                                                SC16IS7X0_SWFLOW_RX_XON1);
+  void disableSoftwareFlowControl(void);
+
+  void enableRS485(bool highOnTx = true);
+  void disableRS485(void);
+  void enableMultidrop(int16_t address = -1);
+  void disableMultidrop(void);
+  bool writeAddress(uint8_t address);
+
+  void enableFrameDelimiter(uint8_t delimiter);
+  void disableFrameDelimiter(void);
+  void enableFrameGap(uint32_t minGapUs = 0);
+  void disableFrameGap(void);
+  uint32_t getFrameGapUs(void) const;
+  bool frameAvailable(void);
+  size_t readFrame(uint8_t *buffer, size_t len, uint32_t *endUs = nullptr);
 
   void enableLoopback(void);
   void disableLoopback(void);
@@ -54,6 +204,21 @@ public:
   void digitalWrite(uint8_t pin, uint8_t val);
   int digitalRead(uint8_t pin);
 
+  // Called with the pin number and its new level (0 or 1)
+  using PinChangeCallback = void (*)(void *arg, uint8_t pin, int val);
+
+  void setPortDirection(uint8_t outputs);
+  void writePort(uint8_t mask, uint8_t value);
+  uint8_t readPort(void);
+  uint8_t refreshPort(void);
+  void setPortInterrupt(uint8_t mask);
+  void attachPinChange(uint8_t pin, PinChangeCallback callback,
+                       void *arg = nullptr);
+  void detachPinChange(uint8_t pin);
+  size_t writePortSequence(const uint8_t *values, size_t len);
+  size_t readPortSequence(uint8_t *values, size_t len);
+  uint32_t getPortSamplePeriodNs(void) const;
+
 protected:
   Adafruit_SPIDevice *spi_dev = NULL; ///< Pointer to SPI bus interface
   enum Prescaler
@@ -61,6 +226,12 @@ protected:
     DIVIDE_BY_1,
     DIVIDE_BY_4
   };
+  enum BusOwner
+  {
+    BUS_BORROWED, // begin(SC16IS7X0_BusIo &)
+    BUS_HEAP,     // begin(SC16IS7X0_BusIo *), begin_SPI_DMA()
+    BUS_IN_PLACE  // begin_SPI(), begin_I2C(), built in _busStorage
+  };
 
 private:
   void writeDivisorAndPrescaler(uint32_t divisor, Prescaler prescaler);
@@ -69,19 +240,149 @@ private:
   void enableTCR_TLR(void);
   void disableTCR_TLR(void);
   uint8_t txlvl(void);
-  bool setBusIo(SC16IS7X0_BusIo *theBusIo);
+  uint8_t readRegister(uint8_t reg);
+  size_t readFifo(uint8_t *buffer, size_t len, uint8_t reg = SC16IS7X0_RHR);
+  size_t writeFifo(const uint8_t *buffer, size_t len,
+                   uint8_t reg = SC16IS7X0_THR);
+  bool commitRegisters(void);
+  bool drainRxFifo(uint8_t keep = 0, uint32_t lastUs = micros());
+  bool drainRxKnown(size_t known);
+  void requestRx(void);
+  void fillTxFifo(bool refresh = false);
+  size_t txCredit(size_t wanted, bool refresh);
+  void updateCharTime(void);
+  void updateTxInterrupt(void);
+  void fetchRx(void);
+  void pushRx(const uint8_t *data, size_t len, uint32_t lastUs);
+  void checkFrameGap(void);
+  void closeFrame(void);
+  bool frameTimed(void) const;
+  uint32_t frameDeadline(void) const;
+  bool rxPollDue(uint32_t now) const;
+  uint32_t rxDeadline(void) const;
+  void updatePollSlack(int32_t late);
+  uint32_t windowUs(int chars) const;
+  void serviceInterrupt(void);
+  bool rxHeld(void) const;
+  void startInterruptMode(void);
+  bool ownsBus(void) const;
+  void wakeServiceTask(void);
+  void waitServiceTask(void);
+#if SC16IS7X0_SERVICE_TASK
+  static void serviceTask(void *arg);
+  TickType_t serviceTicks(void) const;
+#endif
+  static void IRAM_ATTR irqHandler(void *arg);
+  static void onRxLevel(void *arg, bool ok);
+  static void onRxData(void *arg, bool ok);
+  static void onTxDone(void *arg, bool ok);
+  void countBus(size_t out, size_t in, size_t frames = 1);
+  void recordRxLevel(size_t rxlvl);
+  void recordLsr(uint8_t lsr);
+  void tuneTriggerLevels(void);
+  void tuneFlowControlLevels(void);
+  void initFlowControlLevels(void);
+  bool rxFlowControl(void) const;
+  bool portCached(uint8_t mask) const;
+  void updatePort(uint8_t iostate);
+  static uint8_t triggerSteps(int level);
+  bool setBusIo(SC16IS7X0_BusIo *theBusIo, BusOwner owner);
+  void releaseBusIo(void);
+  bool buildSPI(uint32_t freq);
+  void setSPIClock(uint32_t freq);
+  bool testScratchpad(void);
 
   static uint8_t getWordLength(SerialConfig config);
   static uint8_t getParity(SerialConfig config);
   static uint8_t getStopBits(SerialConfig config);
 
-  uint8_t _mcr;
-  uint8_t _lcr;
-  uint8_t _efr;
+  SC16IS7X0_Registers _regs;
   uint32_t _xtalFreq;
-  uint8_t _ioDir;
-  uint8_t _ioState;
+  uint16_t _divisor;
+  SC16IS7X0_BaudPlan _baudPlan;
+  uint32_t _charTimeNs;
+  uint8_t _txCredit;
+  uint32_t _txCreditStamp;
+  int8_t _irqPin;
+  bool _irqMode;
+  volatile bool _irqPending;
+  volatile bool _irqStamped;
+  volatile uint32_t _irqStamp;
+  uint32_t _irqServiceUs; // Last handleInterrupt(), for the idle sweep
+  bool _rxHeld;           // Last handleInterrupt() found _rxBuf full
+  Stats _stats;
+  uint32_t _rxPollUs;
+  bool _rxPolled;
+  uint8_t _rxLeft;
+  uint32_t _txFillUs;
+  uint32_t _txBurstUs; // Last asynchronous TX burst, submitted to callback
+  uint32_t _pollSlackUs;
+  uint32_t _irqLatencyUs;
+  bool _autoTrigger;
+  uint32_t _autoMaxDelayUs;
+  bool _autoFlow;
+  int16_t _delimiter;
+  // Delimiters pushed into / popped from the software RX buffer, each side
+  // owns one counter
+  volatile uint32_t _framesIn;
+  volatile uint32_t _framesOut;
+  // Frames delimited by silence: the open one, then the closed ones
+  struct Frame {
+    uint32_t len;
+    uint32_t endUs;
+  };
+  bool _frameGap;
+  uint32_t _frameMinGapUs;
+  uint32_t _frameLen;
+  uint32_t _lastRxUs;
+  bool _lastRxExact;
+  Frame _frameQueue[SC16IS7X0_FRAME_QUEUE];
+  uint16_t _rtsOvershoot; // In 1/64 characters
+  // Last IOSTATE read, kept up to date by the I/O interrupt for the pins of
+  // IOINTENA
+  uint8_t _ioInputs;
+  bool _ioValid;
+  struct PinChange {
+    PinChangeCallback callback;
+    void *arg;
+  };
+  PinChange _pinChange[8];
+  // Time per IOSTATE sample measured by the last sequence, 0 before
+  uint32_t _portSampleNs;
+  bool _txWaiting;
+  // The THR interrupt will be raised again without help, see fillTxFifo()
+  bool _txArmed;
+  SC16IS7X0_RingBuffer<SC16IS7X0_RX_BUFFER_SIZE> _rxBuf;
+#if SC16IS7X0_SERVICE_TASK
+  // Several tasks may write
+  SC16IS7X0_MpscRingBuffer<SC16IS7X0_TX_BUFFER_SIZE> _txBuf;
+#else
+  SC16IS7X0_RingBuffer<SC16IS7X0_TX_BUFFER_SIZE> _txBuf;
+#endif
   SC16IS7X0_BusIo *busIo;
+  BusOwner _busOwner;
+  // The SPI / I2C transport, no heap allocation at begin_SPI() / begin_I2C()
+  SC16IS7X0_BusStorage _busStorage;
+  // Transactions queued with SC16IS7X0_BusIo::submit() on asynchronous buses
+  SC16IS7X0_BusIo::Transaction _rxOp;
+  SC16IS7X0_BusIo::Transaction _txOp;
+  uint8_t _rxRequest;
+  uint8_t _rxLevel;
+  uint8_t _rxData[SC16IS7X0_FIFO_SIZE];
+  uint8_t _txData[SC16IS7X0_FIFO_SIZE + 1];
+  bool _rxBusy;
+  bool _txBusy;
+  SPIClass *_spi;
+  uint32_t _spiFreq;
+  uint8_t _spiMode;
+  uint8_t _csPin;
+#if SC16IS7X0_SERVICE_TASK
+  TaskHandle_t volatile _task = nullptr;
+  TaskHandle_t volatile _rxWaiter = nullptr;
+  SemaphoreHandle_t _busMutex = nullptr;
+  volatile bool _taskStop = false;
+  volatile bool _flushing = false;
+#endif
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,131 @@
+#ifndef SC16IS7X0_BAUDPLAN_H
+#define SC16IS7X0_BAUDPLAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Largest baudrate error accepted by SC16IS7X0::updateBaudRate() by default,
+// in parts per million. Sender and receiver together must stay well below
+// the half bit over a character (about 5 %).
+#ifndef SC16IS7X0_BAUD_TOLERANCE_PPM
+#define SC16IS7X0_BAUD_TOLERANCE_PPM 20000
+#endif
+
+/**
+ * @brief Divisor and prescaler reaching a baudrate, with the error left
+ * @details baudrate = XTAL1 / (prescaler x 16 x divisor). make() rounds the
+ * divisor to the nearest value for both prescalers and keeps the smallest
+ * error. Everything is constexpr (C++11), a fixed configuration can be
+ * checked at compile time:
+ *
+ *   static_assert(SC16IS7X0_BaudPlan::make(14745600, 115200).within(1000),
+ *                 "115200 baud off by more than 0.1 %");
+ *   static_assert(SC16IS7X0_BaudPlan::worstPpm(1843200, 115200) == 0,
+ *                 "standard baudrates not exact");
+ */
+struct SC16IS7X0_BaudPlan {
+  uint16_t divisor;  // DLH:DLL, 0 if the baudrate cannot be reached
+  uint8_t prescaler; // 1 or 4 (MCR[7])
+  uint32_t baudrate; // Actual baudrate, rounded
+  int32_t errorPpm;  // Actual versus requested, in parts per million
+
+  constexpr bool valid(void) const { return divisor != 0; }
+
+  constexpr uint32_t absErrorPpm(void) const {
+    return errorPpm < 0 ? (uint32_t)-(int64_t)errorPpm : (uint32_t)errorPpm;
+  }
+
+  /**
+   * @brief Whether the baudrate is reached within maxPpm
+   */
+  constexpr bool within(uint32_t maxPpm) const {
+    return valid() && absErrorPpm() <= maxPpm;
+  }
+
+  /**
+   * @brief Best divisor and prescaler for a baudrate
+   *
+   * @param xtalFreq Frequency in Hz of the XTAL1
+   * @param baudrate Requested baudrate
+   * @return Plan, invalid if no divisor fits
+   */
+  static constexpr SC16IS7X0_BaudPlan make(uint32_t xtalFreq,
+                                           uint32_t baudrate) {
+    return better(with(xtalFreq, baudrate, 1), with(xtalFreq, baudrate, 4));
+  }
+
+  /**
+   * @brief Plan with a given prescaler
+   *
+   * @param prescaler 1 or 4
+   */
+  static constexpr SC16IS7X0_BaudPlan with(uint32_t xtalFreq,
+                                           uint32_t baudrate,
+                                           uint8_t prescaler) {
+    return result(xtalFreq, baudrate, prescaler,
+                  divisorFor(xtalFreq, baudrate, prescaler));
+  }
+
+  /**
+   * @brief Largest error over the standard baudrates up to maxBaudrate
+   * (300 to 921600), INT32_MAX if one of them cannot be reached
+   */
+  static constexpr uint32_t worstPpm(uint32_t xtalFreq,
+                                     uint32_t maxBaudrate = 921600,
+                                     size_t i = 0) {
+    return i >= sizeof(standard) / sizeof(standard[0]) ||
+                   standard[i] > maxBaudrate
+               ? 0
+               : max(errorOf(make(xtalFreq, standard[i])),
+                     worstPpm(xtalFreq, maxBaudrate, i + 1));
+  }
+
+  static constexpr uint32_t standard[] = {
+      300,   600,   1200,  2400,   4800,   9600,   14400, 19200,
+      28800, 38400, 57600, 115200, 230400, 460800, 921600};
+
+private:
+  static constexpr uint16_t divisorFor(uint32_t xtalFreq, uint32_t baudrate,
+                                       uint8_t prescaler) {
+    return fit((xtalFreq + 8ULL * prescaler * baudrate) /
+               (16ULL * prescaler * baudrate));
+  }
+
+  static constexpr uint16_t fit(uint64_t divisor) {
+    return divisor > 0xFFFF ? 0 : (uint16_t)divisor;
+  }
+
+  static constexpr SC16IS7X0_BaudPlan result(uint32_t xtalFreq,
+                                             uint32_t baudrate,
+                                             uint8_t prescaler,
+                                             uint16_t divisor) {
+    return divisor == 0
+               ? SC16IS7X0_BaudPlan{0, prescaler, 0, INT32_MAX}
+               : SC16IS7X0_BaudPlan{
+                     divisor, prescaler,
+                     (uint32_t)((xtalFreq + 8ULL * prescaler * divisor) /
+                                (16ULL * prescaler * divisor)),
+                     (int32_t)(((int64_t)xtalFreq * 1000000 /
+                                    (16LL * prescaler * divisor) -
+                                (int64_t)baudrate * 1000000) /
+                               (int64_t)baudrate)};
+  }
+
+  // Same error: the /1 prescaler, first
+  static constexpr SC16IS7X0_BaudPlan better(SC16IS7X0_BaudPlan a,
+                                             SC16IS7X0_BaudPlan b) {
+    return !b.valid() || (a.valid() && a.absErrorPpm() <= b.absErrorPpm())
+               ? a
+               : b;
+  }
+
+  static constexpr uint32_t errorOf(SC16IS7X0_BaudPlan plan) {
+    return plan.valid() ? plan.absErrorPpm() : INT32_MAX;
+  }
+
+  static constexpr uint32_t max(uint32_t a, uint32_t b) {
+    return a > b ? a : b;
+  }
+};
+
+#endif // SC16IS7X0_BAUDPLAN_H
@@ -1,21 +1,114 @@
 #include "SC16IS7X0_BusIo.h"
 
+/**
+ * @brief Write a sequence of registers
+ *
+ * @param writes count pairs of subaddress and value
+ * @param count Number of register writes
+ * @return true if every write succeeded
+ */
+bool SC16IS7X0_BusIo::write_registers(const uint8_t *writes, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (!write(writes + 2 * i, 2))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Queue a transaction, its callback is called once it is complete
+ * @details Without hardware queue the transactions are executed in order by
+ * poll() (or by the next synchronous call), never from submit(). The result
+ * is deterministic and the same code path runs on every bus.
+ *
+ * @param t Transaction, must stay valid until its callback is called
+ * @return false if the transaction cannot be queued
+ */
+bool SC16IS7X0_BusIo::submit(Transaction *t)
+{
+    enqueue(t);
+    return true;
+}
+
+/**
+ * @brief Call the callbacks of the completed transactions
+ * @details Runs in the caller context, a callback may submit new transactions
+ * but must not call the synchronous methods.
+ *
+ * @return size_t Number of completed transactions
+ */
+size_t SC16IS7X0_BusIo::poll(void)
+{
+    if (draining)
+        return 0;
+
+    draining = true;
+    size_t count = 0;
+    Transaction *t;
+    while ((t = dequeue()) != nullptr) {
+        execute(t);
+        count++;
+    }
+    draining = false;
+    return count;
+}
+
+/**
+ * @brief Complete every queued transaction
+ * @details Called first by the synchronous methods so that the bus operations
+ * keep the order in which they were requested.
+ */
+void SC16IS7X0_BusIo::drain(void)
+{
+    poll();
+}
+
+void SC16IS7X0_BusIo::enqueue(Transaction *t)
+{
+    t->next = nullptr;
+    if (queueTail)
+        queueTail->next = t;
+    else
+        queueHead = t;
+    queueTail = t;
+}
+
+SC16IS7X0_BusIo::Transaction *SC16IS7X0_BusIo::dequeue(void)
+{
+    Transaction *t = queueHead;
+    if (t) {
+        queueHead = t->next;
+        if (!queueHead)
+            queueTail = nullptr;
+    }
+    return t;
+}
+
+void SC16IS7X0_BusIo::execute(Transaction *t)
+{
+    bool ok;
+    if (t->rx_len > 0)
+        ok = write_then_read(t->tx, t->tx_len, t->rx, t->rx_len);
+    else
+        ok = write(t->tx, t->tx_len);
+    t->done(t->arg, ok);
+}
+
 SC16IS7X0_I2C::SC16IS7X0_I2C(uint8_t addr, TwoWire *theWire)
+    : i2c(addr, theWire)
 {
-    i2c = new Adafruit_I2CDevice(addr, theWire);
-    i2c->begin(false);
+    i2c.begin(false);
 }
 
 SC16IS7X0_I2C::~SC16IS7X0_I2C()
 {
-    delete i2c;
 }
 
 bool SC16IS7X0_I2C::read(uint8_t *buffer, size_t len)
 {
-    if (!i2c)
-        return false;
-    return i2c->read(buffer, len);
+    drain();
+    return i2c.read(buffer, len);
 }
 
 bool SC16IS7X0_I2C::write(const uint8_t *buffer,
@@ -23,9 +116,8 @@ bool SC16IS7X0_I2C::write(const uint8_t *buffer,
                           const uint8_t *prefix_buffer,
                           size_t prefix_len)
 {
-    if (!i2c)
-        return false;
-    return i2c->write(buffer, len, true, prefix_buffer, prefix_len);
+    drain();
+    return i2c.write(buffer, len, true, prefix_buffer, prefix_len);
 }
 
 bool SC16IS7X0_I2C::write_then_read(const uint8_t *write_buffer,
@@ -33,9 +125,30 @@ bool SC16IS7X0_I2C::write_then_read(const uint8_t *write_buffer,
                                     uint8_t *read_buffer,
                                     size_t read_len)
 {
-    if (!i2c)
-        return false;
-    return i2c->write_then_read(write_buffer, write_len, read_buffer, read_len);
+    drain();
+    return i2c.write_then_read(write_buffer, write_len, read_buffer, read_len);
+}
+
+bool SC16IS7X0_I2C::write_registers(const uint8_t *writes, size_t count)
+{
+    drain();
+
+    // Repeated START between the writes, the bus is released only at the end
+    for (size_t i = 0; i < count; i++) {
+        if (!i2c.write(writes + 2 * i, 2, i + 1 == count))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Largest transaction accepted by the I2C layer, subaddress included
+ *
+ * @return size_t Size of the Wire buffer
+ */
+size_t SC16IS7X0_I2C::maxTransferSize(void)
+{
+    return i2c.maxBufferSize();
 }
 
 SC16IS7X0_SPI::SC16IS7X0_SPI(int8_t cspin,
@@ -43,21 +156,73 @@ SC16IS7X0_SPI::SC16IS7X0_SPI(int8_t cspin,
                              BusIOBitOrder dataOrder,
                              uint8_t dataMode,
                              SPIClass *theSPI)
+    : spi(theSPI),
+      settings(freq, dataOrder == SPI_BITORDER_LSBFIRST ? LSBFIRST : MSBFIRST,
+               dataMode),
+      cs(cspin),
+      order(dataOrder == SPI_BITORDER_LSBFIRST ? LSBFIRST : MSBFIRST),
+      mode(dataMode)
 {
-    spi = new Adafruit_SPIDevice(cspin, freq, dataOrder, dataMode, theSPI);
+    if (cs >= 0) {
+        pinMode(cs, OUTPUT);
+        digitalWrite(cs, HIGH);
+    }
     spi->begin();
 }
 
 SC16IS7X0_SPI::~SC16IS7X0_SPI()
 {
-    delete spi;
+}
+
+/**
+ * @brief Change the SPI clock, effective from the next transaction
+ *
+ * @param freq SPI clock in Hz
+ */
+void SC16IS7X0_SPI::setClock(uint32_t freq)
+{
+    drain();
+    settings = SPISettings(freq, order, mode);
+}
+
+void SC16IS7X0_SPI::select(void)
+{
+    spi->beginTransaction(settings);
+    if (cs >= 0)
+        digitalWrite(cs, LOW);
+}
+
+void SC16IS7X0_SPI::deselect(void)
+{
+    if (cs >= 0)
+        digitalWrite(cs, HIGH);
+    spi->endTransaction();
+}
+
+/**
+ * @brief Clock out a buffer within a selected transaction, what comes back
+ * is discarded
+ */
+void SC16IS7X0_SPI::send(const uint8_t *buffer, size_t len)
+{
+    if (len == 0)
+        return;
+#ifdef ESP32
+    spi->transferBytes(buffer, nullptr, len);
+#else
+    for (size_t i = 0; i < len; i++)
+        spi->transfer(buffer[i]);
+#endif
 }
 
 bool SC16IS7X0_SPI::read(uint8_t *buffer, size_t len)
 {
-    if (!spi)
-        return false;
-    return spi->read(buffer, len);
+    drain();
+    memset(buffer, 0xFF, len);
+    select();
+    spi->transfer(buffer, len);
+    deselect();
+    return true;
 }
 
 bool SC16IS7X0_SPI::write(const uint8_t *buffer,
@@ -65,9 +230,12 @@ bool SC16IS7X0_SPI::write(const uint8_t *buffer,
                           const uint8_t *prefix_buffer,
                           size_t prefix_len)
 {
-    if (!spi)
-        return false;
-    return spi->write(buffer, len, prefix_buffer, prefix_len);
+    drain();
+    select();
+    send(prefix_buffer, prefix_len);
+    send(buffer, len);
+    deselect();
+    return true;
 }
 
 bool SC16IS7X0_SPI::write_then_read(const uint8_t *write_buffer,
@@ -75,9 +243,30 @@ bool SC16IS7X0_SPI::write_then_read(const uint8_t *write_buffer,
                                     uint8_t *read_buffer,
                                     size_t read_len)
 {
-    if (!spi)
-        return false;
-    return spi->write_then_read(write_buffer, write_len, read_buffer, read_len);
+    drain();
+    memset(read_buffer, 0xFF, read_len);
+    select();
+    send(write_buffer, write_len);
+    spi->transfer(read_buffer, read_len);
+    deselect();
+    return true;
+}
+
+bool SC16IS7X0_SPI::write_registers(const uint8_t *writes, size_t count)
+{
+    drain();
+
+    // One SPI transaction, chip select toggled between the writes
+    spi->beginTransaction(settings);
+    for (size_t i = 0; i < count; i++) {
+        if (cs >= 0)
+            digitalWrite(cs, LOW);
+        send(writes + 2 * i, 2);
+        if (cs >= 0)
+            digitalWrite(cs, HIGH);
+    }
+    spi->endTransaction();
+    return true;
 }
 
 SC16IS7X0_BusIo *SC16IS7X0_BusIo::buildSPI(int8_t cspin, uint32_t freq, BusIOBitOrder dataOrder, uint8_t dataMode, SPIClass *theSPI)
@@ -89,3 +278,250 @@ SC16IS7X0_BusIo *SC16IS7X0_BusIo::buildI2C(uint8_t addr, TwoWire *theWire)
 {
     return new SC16IS7X0_I2C(addr, theWire);
 }
+
+/**
+ * @brief Build the SPI transport in storage instead of the heap
+ * @details The previous object of storage, if any, must have been destroyed.
+ * The caller destroys the new one (~SC16IS7X0_BusIo()) instead of deleting it.
+ */
+SC16IS7X0_BusIo *SC16IS7X0_BusIo::buildSPI(SC16IS7X0_BusStorage *storage, int8_t cspin,
+                                           uint32_t freq, BusIOBitOrder dataOrder,
+                                           uint8_t dataMode, SPIClass *theSPI)
+{
+    return new (&storage->spi) SC16IS7X0_SPI(cspin, freq, dataOrder, dataMode, theSPI);
+}
+
+/**
+ * @brief Build the I2C transport in storage instead of the heap, see
+ * buildSPI(SC16IS7X0_BusStorage *, ...)
+ */
+SC16IS7X0_BusIo *SC16IS7X0_BusIo::buildI2C(SC16IS7X0_BusStorage *storage, uint8_t addr,
+                                           TwoWire *theWire)
+{
+    return new (&storage->i2c) SC16IS7X0_I2C(addr, theWire);
+}
+
+#ifdef ESP32
+SC16IS7X0_SPIDMA::SC16IS7X0_SPIDMA(int8_t cspin,
+                                   int8_t sck,
+                                   int8_t miso,
+                                   int8_t mosi,
+                                   uint32_t freq,
+                                   uint8_t dataMode,
+                                   spi_host_device_t host)
+{
+    spi_bus_config_t bus = {};
+    bus.mosi_io_num = mosi;
+    bus.miso_io_num = miso;
+    bus.sclk_io_num = sck;
+    bus.quadwp_io_num = -1;
+    bus.quadhd_io_num = -1;
+    bus.max_transfer_sz = SC16IS7X0_SPIDMA_MAX_TRANSFER;
+
+    // ESP_ERR_INVALID_STATE: already initialized by another device
+    esp_err_t err = spi_bus_initialize(host, &bus, SPI_DMA_CH_AUTO);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
+        return;
+
+    // The subaddress is sent in the address phase, data is read after it in
+    // half-duplex mode
+    spi_device_interface_config_t cfg = {};
+    cfg.address_bits = 8;
+    cfg.mode = dataMode;
+    cfg.clock_speed_hz = freq;
+    cfg.spics_io_num = cspin;
+    cfg.flags = SPI_DEVICE_HALFDUPLEX;
+    cfg.queue_size = QUEUE_SIZE;
+    if (spi_bus_add_device(host, &cfg, &dev) != ESP_OK)
+        dev = nullptr;
+}
+
+SC16IS7X0_SPIDMA::~SC16IS7X0_SPIDMA()
+{
+    drain();
+    if (dev)
+        spi_bus_remove_device(dev);
+}
+
+bool SC16IS7X0_SPIDMA::read(uint8_t *buffer, size_t len)
+{
+    drain();
+    if (!dev)
+        return false;
+
+    // No subaddress
+    spi_transaction_ext_t ext = {};
+    ext.base.flags = SPI_TRANS_VARIABLE_ADDR;
+    ext.address_bits = 0;
+    ext.base.rxlength = len * 8;
+    ext.base.rx_buffer = buffer;
+    return spi_device_polling_transmit(dev, &ext.base) == ESP_OK;
+}
+
+bool SC16IS7X0_SPIDMA::write(const uint8_t *buffer,
+                             size_t len,
+                             const uint8_t *prefix_buffer,
+                             size_t prefix_len)
+{
+    if (prefix_len == 1)
+        return transmit(prefix_buffer[0], buffer, len, nullptr, 0);
+    if (prefix_len == 0 && len > 0)
+        return transmit(buffer[0], buffer + 1, len - 1, nullptr, 0);
+    return false;
+}
+
+bool SC16IS7X0_SPIDMA::write_then_read(const uint8_t *write_buffer,
+                                       size_t write_len,
+                                       uint8_t *read_buffer,
+                                       size_t read_len)
+{
+    if (write_len != 1)
+        return false;
+    return transmit(write_buffer[0], nullptr, 0, read_buffer, read_len);
+}
+
+bool SC16IS7X0_SPIDMA::write_registers(const uint8_t *writes, size_t count)
+{
+    drain();
+    if (!dev)
+        return false;
+
+    bool ok = spi_device_acquire_bus(dev, portMAX_DELAY) == ESP_OK;
+    for (size_t i = 0; ok && i < count; i++) {
+        spi_transaction_t st;
+        prepare(&st, writes[2 * i], writes + 2 * i + 1, 1, nullptr, 0);
+        ok = spi_device_polling_transmit(dev, &st) == ESP_OK;
+    }
+    spi_device_release_bus(dev);
+    return ok;
+}
+
+size_t SC16IS7X0_SPIDMA::maxTransferSize(void)
+{
+    return SC16IS7X0_SPIDMA_MAX_TRANSFER;
+}
+
+/**
+ * @brief Queue a transaction to the SPI driver
+ * @details tx[0] is the subaddress. A transaction writes (rx_len = 0) or
+ * reads (tx_len = 1), not both.
+ */
+bool SC16IS7X0_SPIDMA::submit(Transaction *t)
+{
+    if (!dev)
+        return false;
+
+    enqueue(t);
+    start();
+    return true;
+}
+
+size_t SC16IS7X0_SPIDMA::poll(void)
+{
+    size_t count = complete(0);
+    start();
+    return count;
+}
+
+void SC16IS7X0_SPIDMA::drain(void)
+{
+    // A callback calling a synchronous method must not wait for itself
+    if (draining)
+        return;
+
+    draining = true;
+    while (inFlight > 0 || queueHead) {
+        start();
+        complete(portMAX_DELAY);
+    }
+    draining = false;
+}
+
+void SC16IS7X0_SPIDMA::prepare(spi_transaction_t *st,
+                               uint8_t subaddress,
+                               const uint8_t *tx,
+                               size_t tx_len,
+                               uint8_t *rx,
+                               size_t rx_len)
+{
+    memset(st, 0, sizeof(*st));
+    st->addr = subaddress;
+    st->length = tx_len * 8;
+    st->tx_buffer = tx_len ? tx : nullptr;
+    st->rxlength = rx_len * 8;
+    st->rx_buffer = rx_len ? rx : nullptr;
+}
+
+bool SC16IS7X0_SPIDMA::transmit(uint8_t subaddress,
+                                const uint8_t *tx,
+                                size_t tx_len,
+                                uint8_t *rx,
+                                size_t rx_len)
+{
+    drain();
+    if (!dev)
+        return false;
+
+    spi_transaction_t st;
+    prepare(&st, subaddress, tx, tx_len, rx, rx_len);
+    return spi_device_polling_transmit(dev, &st) == ESP_OK;
+}
+
+/**
+ * @brief Hand the queued transactions to the driver while it has room
+ */
+void SC16IS7X0_SPIDMA::start(void)
+{
+    for (size_t i = 0; i < QUEUE_SIZE && queueHead; i++) {
+        if (owners[i])
+            continue;
+
+        Transaction *t = dequeue();
+        bool ok = t->tx_len > 0 && (t->tx_len == 1 || t->rx_len == 0);
+        if (ok) {
+            prepare(&slots[i], t->tx[0], t->tx + 1, t->tx_len - 1, t->rx,
+                    t->rx_len);
+            ok = spi_device_queue_trans(dev, &slots[i], 0) == ESP_OK;
+        }
+        if (!ok) {
+            t->done(t->arg, false);
+            continue;
+        }
+
+        owners[i] = t;
+        inFlight++;
+    }
+}
+
+/**
+ * @brief Collect the finished transactions and call their callback
+ *
+ * @param wait Ticks to wait for the first one
+ * @return size_t Number of completed transactions
+ */
+size_t SC16IS7X0_SPIDMA::complete(TickType_t wait)
+{
+    size_t count = 0;
+    spi_transaction_t *st;
+    while (inFlight > 0 && spi_device_get_trans_result(dev, &st, wait) == ESP_OK) {
+        size_t i = st - slots;
+        Transaction *t = owners[i];
+        owners[i] = nullptr;
+        inFlight--;
+        count++;
+
+        // Keep the bus busy while the callback runs
+        start();
+        t->done(t->arg, true);
+        wait = 0;
+    }
+    return count;
+}
+
+SC16IS7X0_BusIo *SC16IS7X0_BusIo::buildSPIDMA(int8_t cspin, int8_t sck, int8_t miso, int8_t mosi,
+                                              uint32_t freq, uint8_t dataMode,
+                                              spi_host_device_t host)
+{
+    return new SC16IS7X0_SPIDMA(cspin, sck, miso, mosi, freq, dataMode, host);
+}
+#endif
@@ -1,10 +1,25 @@
 #pragma once
 
+#include <new>
+
 #include <Adafruit_I2CDevice.h>
 #include <Adafruit_SPIDevice.h>
 
+#ifdef ESP32
+#include <driver/spi_master.h>
+
+// Largest SPI transaction of SC16IS7X0_SPIDMA, subaddress included
+#ifndef SC16IS7X0_SPIDMA_MAX_TRANSFER
+#define SC16IS7X0_SPIDMA_MAX_TRANSFER 128
+#endif
+#endif
+
 class SC16IS7X0_I2C;
 class SC16IS7X0_SPI;
+union SC16IS7X0_BusStorage;
+#ifdef ESP32
+class SC16IS7X0_SPIDMA;
+#endif
 
 class SC16IS7X0_BusIo
 {
@@ -15,23 +30,72 @@ public:
         I2C_BUS
     };
 
+    /**
+     * @brief Bus transaction queued with submit()
+     * @details tx_len bytes of tx (the subaddress first) are sent, then rx_len
+     * bytes are read into rx (rx_len = 0 for a write). The transaction and
+     * its buffers must stay valid until done is called.
+     */
+    struct Transaction
+    {
+        const uint8_t *tx;
+        size_t tx_len;
+        uint8_t *rx;
+        size_t rx_len;
+        void (*done)(void *arg, bool ok);
+        void *arg;
+        Transaction *next; // Owned by the queue
+    };
+
     virtual ~SC16IS7X0_BusIo(){};
     virtual bool read(uint8_t *buffer, size_t len) = 0;
     virtual bool write(const uint8_t *buffer, size_t len,
                        const uint8_t *prefix_buffer = nullptr, size_t prefix_len = 0) = 0;
     virtual bool write_then_read(const uint8_t *write_buffer, size_t write_len,
                                  uint8_t *read_buffer, size_t read_len) = 0;
+    virtual bool write_registers(const uint8_t *writes, size_t count);
+    virtual size_t maxTransferSize(void) { return SIZE_MAX; }
+
+    virtual bool submit(Transaction *t);
+    virtual size_t poll(void);
+    virtual void drain(void);
+
+    /**
+     * @brief true if submitted transactions progress without the CPU (DMA),
+     * false if they are only executed by poll()
+     */
+    virtual bool isAsync(void) { return false; }
 
     static SC16IS7X0_BusIo *buildSPI(int8_t cspin, uint32_t freq = 4000000,
                                       BusIOBitOrder dataOrder = SPI_BITORDER_MSBFIRST,
                                       uint8_t dataMode = SPI_MODE0, SPIClass *theSPI = &SPI);
     static SC16IS7X0_BusIo *buildI2C(uint8_t addr, TwoWire *theWire = &Wire);
+    static SC16IS7X0_BusIo *buildSPI(SC16IS7X0_BusStorage *storage, int8_t cspin,
+                                      uint32_t freq = 4000000,
+                                      BusIOBitOrder dataOrder = SPI_BITORDER_MSBFIRST,
+                                      uint8_t dataMode = SPI_MODE0, SPIClass *theSPI = &SPI);
+    static SC16IS7X0_BusIo *buildI2C(SC16IS7X0_BusStorage *storage, uint8_t addr,
+                                      TwoWire *theWire = &Wire);
+#ifdef ESP32
+    static SC16IS7X0_BusIo *buildSPIDMA(int8_t cspin, int8_t sck, int8_t miso, int8_t mosi,
+                                         uint32_t freq = 4000000, uint8_t dataMode = SPI_MODE0,
+                                         spi_host_device_t host = SPI2_HOST);
+#endif
+
+protected:
+    void enqueue(Transaction *t);
+    Transaction *dequeue(void);
+    void execute(Transaction *t);
+
+    Transaction *queueHead = nullptr;
+    Transaction *queueTail = nullptr;
+    bool draining = false;
 };
 
-class SC16IS7X0_I2C : public SC16IS7X0_BusIo
+class SC16IS7X0_I2C final : public SC16IS7X0_BusIo
 {
 private:
-    Adafruit_I2CDevice *i2c = nullptr;
+    Adafruit_I2CDevice i2c;
 
     friend SC16IS7X0_BusIo;
 
@@ -45,12 +109,24 @@ public:
                const uint8_t *prefix_buffer = nullptr, size_t prefix_len = 0) override;
     bool write_then_read(const uint8_t *write_buffer, size_t write_len,
                          uint8_t *read_buffer, size_t read_len) override;
+    bool write_registers(const uint8_t *writes, size_t count) override;
+    size_t maxTransferSize(void) override;
 };
 
-class SC16IS7X0_SPI : public SC16IS7X0_BusIo
+/**
+ * @brief Hardware SPI through SPIClass
+ * @details The settings are held by value: Adafruit_SPIDevice allocates its
+ * SPISettings and cannot change its clock, the clock of this transport is
+ * changed in place by setClock().
+ */
+class SC16IS7X0_SPI final : public SC16IS7X0_BusIo
 {
 private:
-    Adafruit_SPIDevice *spi = nullptr;
+    SPIClass *spi;
+    SPISettings settings;
+    int8_t cs;
+    uint8_t order;
+    uint8_t mode;
 
     friend SC16IS7X0_BusIo;
     // to avoid direct instantiation
@@ -58,6 +134,10 @@ private:
                   BusIOBitOrder dataOrder,
                   uint8_t dataMode, SPIClass *theSPI);
 
+    void select(void);
+    void deselect(void);
+    void send(const uint8_t *buffer, size_t len);
+
 public:
     ~SC16IS7X0_SPI();
     bool read(uint8_t *buffer, size_t len) override;
@@ -65,4 +145,67 @@ public:
                const uint8_t *prefix_buffer = nullptr, size_t prefix_len = 0) override;
     bool write_then_read(const uint8_t *write_buffer, size_t write_len,
                          uint8_t *read_buffer, size_t read_len) override;
-};
\ No newline at end of file
+    bool write_registers(const uint8_t *writes, size_t count) override;
+    void setClock(uint32_t freq);
+};
+
+/**
+ * @brief Room for the SPI or I2C transport of one device, built in place by
+ * buildSPI() / buildI2C() without heap allocation
+ * @details Holds no object until one is built. The owner destroys it through
+ * the SC16IS7X0_BusIo virtual destructor before building the next one.
+ */
+union SC16IS7X0_BusStorage
+{
+    SC16IS7X0_BusStorage() {}
+    ~SC16IS7X0_BusStorage() {}
+
+    SC16IS7X0_SPI spi;
+    SC16IS7X0_I2C i2c;
+};
+
+#ifdef ESP32
+/**
+ * @brief SPI through the ESP-IDF master driver, FIFO bursts use DMA
+ * @details The host is initialized by the first device and must not be used
+ * by the Arduino SPIClass. Submitted transactions are queued to the driver and
+ * transferred while the CPU does something else, poll() calls the callbacks
+ * of the completed ones. Synchronous calls first wait for the queue.
+ */
+class SC16IS7X0_SPIDMA : public SC16IS7X0_BusIo
+{
+private:
+    static constexpr size_t QUEUE_SIZE = 4;
+
+    spi_device_handle_t dev = nullptr;
+    spi_transaction_t slots[QUEUE_SIZE];
+    Transaction *owners[QUEUE_SIZE] = {};
+    size_t inFlight = 0;
+
+    friend SC16IS7X0_BusIo;
+    // to avoid direct instantiation
+    SC16IS7X0_SPIDMA(int8_t cspin, int8_t sck, int8_t miso, int8_t mosi,
+                     uint32_t freq, uint8_t dataMode, spi_host_device_t host);
+
+    void prepare(spi_transaction_t *st, uint8_t subaddress, const uint8_t *tx,
+                 size_t tx_len, uint8_t *rx, size_t rx_len);
+    bool transmit(uint8_t subaddress, const uint8_t *tx, size_t tx_len,
+                  uint8_t *rx, size_t rx_len);
+    void start(void);
+    size_t complete(TickType_t wait);
+
+public:
+    ~SC16IS7X0_SPIDMA();
+    bool read(uint8_t *buffer, size_t len) override;
+    bool write(const uint8_t *buffer, size_t len,
+               const uint8_t *prefix_buffer = nullptr, size_t prefix_len = 0) override;
+    bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                         uint8_t *read_buffer, size_t read_len) override;
+    bool write_registers(const uint8_t *writes, size_t count) override;
+    size_t maxTransferSize(void) override;
+    bool submit(Transaction *t) override;
+    size_t poll(void) override;
+    void drain(void) override;
+    bool isAsync(void) override { return dev != nullptr; }
+};
+#endif
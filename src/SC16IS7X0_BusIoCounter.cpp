@@ -0,0 +1,99 @@
+#include "SC16IS7X0_BusIoCounter.h"
+
+SC16IS7X0_BusIoCounter::SC16IS7X0_BusIoCounter(SC16IS7X0_BusIo *inner)
+    : _inner(inner)
+{
+    reset();
+}
+
+SC16IS7X0_BusIoCounter::~SC16IS7X0_BusIoCounter()
+{
+    delete _inner;
+}
+
+void SC16IS7X0_BusIoCounter::reset(void)
+{
+    _stats = {};
+}
+
+bool SC16IS7X0_BusIoCounter::read(uint8_t *buffer, size_t len)
+{
+    uint32_t start = micros();
+    bool ok = _inner->read(buffer, len);
+    count(0, len, start);
+    return ok;
+}
+
+bool SC16IS7X0_BusIoCounter::write(const uint8_t *buffer,
+                                   size_t len,
+                                   const uint8_t *prefix_buffer,
+                                   size_t prefix_len)
+{
+    uint32_t start = micros();
+    bool ok = _inner->write(buffer, len, prefix_buffer, prefix_len);
+    count(prefix_len + len, 0, start);
+    return ok;
+}
+
+bool SC16IS7X0_BusIoCounter::write_then_read(const uint8_t *write_buffer,
+                                             size_t write_len,
+                                             uint8_t *read_buffer,
+                                             size_t read_len)
+{
+    uint32_t start = micros();
+    bool ok = _inner->write_then_read(write_buffer, write_len, read_buffer, read_len);
+    count(write_len, read_len, start);
+    return ok;
+}
+
+bool SC16IS7X0_BusIoCounter::write_registers(const uint8_t *writes, size_t count)
+{
+    uint32_t start = micros();
+    bool ok = _inner->write_registers(writes, count);
+    _stats.busyUs += micros() - start;
+    // One frame per register
+    _stats.transactions += count;
+    _stats.bytesOut += 2 * count;
+    return ok;
+}
+
+size_t SC16IS7X0_BusIoCounter::maxTransferSize(void)
+{
+    return _inner->maxTransferSize();
+}
+
+/**
+ * @brief Counted when submitted, the transfer time is not charged
+ */
+bool SC16IS7X0_BusIoCounter::submit(Transaction *t)
+{
+    _stats.transactions++;
+    _stats.bytesOut += t->tx_len;
+    _stats.bytesIn += t->rx_len;
+    return _inner->submit(t);
+}
+
+size_t SC16IS7X0_BusIoCounter::poll(void)
+{
+    return _inner->poll();
+}
+
+void SC16IS7X0_BusIoCounter::drain(void)
+{
+    uint32_t start = micros();
+    _inner->drain();
+    _stats.busyUs += micros() - start;
+}
+
+bool SC16IS7X0_BusIoCounter::isAsync(void)
+{
+    return _inner->isAsync();
+}
+
+void SC16IS7X0_BusIoCounter::count(size_t out, size_t in, uint32_t start)
+{
+    _stats.busyUs += micros() - start;
+    _stats.transactions++;
+    _stats.bytesOut += out;
+    _stats.bytesIn += in;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "SC16IS7X0_BusIo.h"
+
+/**
+ * @brief SC16IS7X0_BusIo wrapper counting the transactions, the bytes on the
+ * bus and the time spent in the bus calls
+ * @details Forwards every call to the wrapped bus, which it owns. Attach it
+ * with SC16IS7X0::begin() to measure what the library costs on the bus, on
+ * target or against the simulated device of extras/host.
+ */
+class SC16IS7X0_BusIoCounter : public SC16IS7X0_BusIo
+{
+public:
+    struct Stats
+    {
+        uint32_t transactions; // Chip select frames or I2C (repeated) STARTs
+        uint32_t bytesOut;     // Subaddresses and data sent to the device
+        uint32_t bytesIn;      // Data read from the device
+        uint32_t busyUs;       // Time spent in synchronous calls
+    };
+
+    SC16IS7X0_BusIoCounter(SC16IS7X0_BusIo *inner);
+    ~SC16IS7X0_BusIoCounter();
+
+    bool read(uint8_t *buffer, size_t len) override;
+    bool write(const uint8_t *buffer, size_t len,
+               const uint8_t *prefix_buffer = nullptr, size_t prefix_len = 0) override;
+    bool write_then_read(const uint8_t *write_buffer, size_t write_len,
+                         uint8_t *read_buffer, size_t read_len) override;
+    bool write_registers(const uint8_t *writes, size_t count) override;
+    size_t maxTransferSize(void) override;
+    bool submit(Transaction *t) override;
+    size_t poll(void) override;
+    void drain(void) override;
+    bool isAsync(void) override;
+
+    const Stats &stats(void) const { return _stats; }
+    void reset(void);
+
+    /**
+     * @brief Wrapped bus
+     */
+    SC16IS7X0_BusIo *inner(void) const { return _inner; }
+
+private:
+    void count(size_t out, size_t in, uint32_t start);
+
+    SC16IS7X0_BusIo *_inner;
+    Stats _stats;
+};
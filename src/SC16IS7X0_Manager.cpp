@@ -0,0 +1,290 @@
+/**
+ * @file SC16IS7X0_Manager.cpp
+ * @brief Fair servicing of several SC16IS7X0 on a shared bus
+ *
+ * @copyright MIT License
+ */
+
+#include "SC16IS7X0_Manager.h"
+
+// Bound on the IIR scans done while the shared IRQ line stays asserted
+#define SC16IS7X0_MANAGER_IRQ_ROUNDS 4
+
+SC16IS7X0_Manager::SC16IS7X0_Manager(Policy policy)
+    : _count(0), _next(0), _policy(policy), _irqPin(-1), _irqPending(false),
+      _irqStamp(0) {}
+
+/**
+ * @brief Add a device, begin_SPI() / begin_I2C() and begin_UART() must have
+ * been called
+ *
+ * @param port Device to service, must outlive the manager
+ * @return false if the manager is full or the device already added
+ */
+bool SC16IS7X0_Manager::add(SC16IS7X0 *port) {
+  if (port == nullptr || _count >= SC16IS7X0_MANAGER_MAX_PORTS)
+    return false;
+
+  for (uint8_t i = 0; i < _count; i++) {
+    if (_slots[i].port == port)
+      return false;
+  }
+
+  Slot &slot = _slots[_count++];
+  slot.port = port;
+  slot.lastService = micros();
+  slot.stats = {};
+
+  if (_irqPin >= 0)
+    port->enableSharedInterrupt();
+  return true;
+}
+
+/**
+ * @brief Device at index, in the order they were added
+ *
+ * @return nullptr if index is out of range
+ */
+SC16IS7X0 *SC16IS7X0_Manager::port(uint8_t index) const {
+  if (index >= _count)
+    return nullptr;
+  return _slots[index].port;
+}
+
+/**
+ * @brief Use an IRQ line shared by all the devices
+ * @details The open-drain IRQ outputs are wired together on one MCU pin.
+ * Every device is switched to SC16IS7X0::enableSharedInterrupt(), service()
+ * then scans the IIR of all the devices while the line is low.
+ *
+ * @param irqPin MCU pin connected to the IRQ outputs (active low)
+ * @return true if the pin supports interrupts
+ */
+bool SC16IS7X0_Manager::enableInterrupt(uint8_t irqPin) {
+  int irq = digitalPinToInterrupt(irqPin);
+  if (irq == NOT_AN_INTERRUPT)
+    return false;
+
+  if (_irqPin >= 0)
+    detachInterrupt(digitalPinToInterrupt(_irqPin));
+
+  _irqPin = irqPin;
+  ::pinMode(irqPin, INPUT_PULLUP);
+  attachInterruptArg(irq, irqHandler, this, FALLING);
+
+  for (uint8_t i = 0; i < _count; i++)
+    _slots[i].port->enableSharedInterrupt();
+
+  // The line may already be low, no edge would be seen
+  _irqStamp = micros();
+  _irqPending = true;
+  return true;
+}
+
+/**
+ * @brief Go back to polling every device
+ *
+ */
+void SC16IS7X0_Manager::disableInterrupt(void) {
+  if (_irqPin < 0)
+    return;
+
+  detachInterrupt(digitalPinToInterrupt(_irqPin));
+  _irqPin = -1;
+  _irqPending = false;
+
+  uint32_t now = micros();
+  for (uint8_t i = 0; i < _count; i++) {
+    _slots[i].port->disableInterrupt();
+    _slots[i].lastService = now;
+  }
+}
+
+/**
+ * @brief Serve the devices, call it from the main loop or a task
+ * @details Polled mode: with ROUND_ROBIN every device is served in turn, the
+ * first one rotating between calls. With EARLIEST_DEADLINE only the devices
+ * whose deadline has passed are served, the most late first.
+ *
+ * Interrupt mode: every device reporting an interrupt is served until the
+ * shared line is released, budget is ignored. Then, by the policy, the
+ * devices whose deadline has passed although they do not assert the line:
+ * open frame of enableFrameGap(), transactions in flight on an asynchronous
+ * bus, safety sweep after SC16IS7X0_POLL_IDLE_US, TX FIFO refill.
+ *
+ * @param budget Maximum number of devices served by this call (by deadline
+ * in interrupt mode), 0 for no limit
+ * @return uint8_t Number of devices served
+ */
+uint8_t SC16IS7X0_Manager::service(uint8_t budget) {
+  if (_count == 0)
+    return 0;
+
+  uint8_t served = 0;
+  if (_irqPin >= 0)
+    served = serviceInterrupt();
+
+  if (budget == 0 || budget > _count)
+    budget = _count;
+
+  if (_policy == ROUND_ROBIN)
+    return served + serviceRoundRobin(budget, _irqPin >= 0);
+  return served + serviceEarliestDeadline(budget);
+}
+
+/**
+ * @brief Time (micros()) by which service() should be called: the earliest
+ * deadline of the devices, now while the shared IRQ line is asserted
+ *
+ * @return uint32_t Deadline in micros() time, now or in the past if due
+ */
+uint32_t SC16IS7X0_Manager::nextServiceDeadline(void) const {
+  uint32_t now = micros();
+  if (_irqPin >= 0 && (_irqPending || digitalRead(_irqPin) == LOW))
+    return now;
+
+  uint32_t earliest = now + SC16IS7X0_POLL_IDLE_US;
+  for (uint8_t i = 0; i < _count; i++) {
+    uint32_t due = deadline(_slots[i]);
+    if ((int32_t)(due - earliest) < 0)
+      earliest = due;
+  }
+  return earliest;
+}
+
+/**
+ * @brief Service statistics of the device at index
+ *
+ */
+const SC16IS7X0_Manager::PortStats &
+SC16IS7X0_Manager::stats(uint8_t index) const {
+  static const PortStats none = {};
+  if (index >= _count)
+    return none;
+  return _slots[index].stats;
+}
+
+void SC16IS7X0_Manager::resetStats(void) {
+  for (uint8_t i = 0; i < _count; i++)
+    _slots[i].stats = {};
+}
+
+void IRAM_ATTR SC16IS7X0_Manager::irqHandler(void *arg) {
+  SC16IS7X0_Manager *manager = static_cast<SC16IS7X0_Manager *>(arg);
+  if (!manager->_irqPending) {
+    manager->_irqStamp = micros();
+    manager->_irqPending = true;
+  }
+}
+
+/**
+ * @brief Time at which the device should be served again
+ * @details See SC16IS7X0::nextServiceDeadline(): before the RX FIFO may
+ * overrun from the level seen by the last service, or the transmitter idles.
+ */
+uint32_t SC16IS7X0_Manager::deadline(const Slot &slot) const {
+  return slot.port->nextServiceDeadline();
+}
+
+void SC16IS7X0_Manager::servePolled(Slot &slot, uint32_t due) {
+  slot.port->service();
+  record(slot, due, micros());
+}
+
+void SC16IS7X0_Manager::record(Slot &slot, uint32_t due, uint32_t end) {
+  PortStats &stats = slot.stats;
+
+  int32_t late = (int32_t)(end - due);
+  stats.lastLatencyUs = late > 0 ? (uint32_t)late : 0;
+  if (stats.lastLatencyUs > stats.maxLatencyUs)
+    stats.maxLatencyUs = stats.lastLatencyUs;
+
+  uint32_t interval = end - slot.lastService;
+  if (stats.services > 0 && interval > stats.maxIntervalUs)
+    stats.maxIntervalUs = interval;
+
+  stats.services++;
+  slot.lastService = end;
+}
+
+uint8_t SC16IS7X0_Manager::serviceInterrupt(void) {
+  uint32_t due;
+  if (_irqPending) {
+    due = _irqStamp;
+    _irqPending = false;
+  } else if (digitalRead(_irqPin) == LOW) {
+    // Still asserted by a device left pending by the previous scan
+    due = micros();
+  } else {
+    return 0;
+  }
+
+  uint8_t served = 0;
+  for (uint8_t round = 0; round < SC16IS7X0_MANAGER_IRQ_ROUNDS; round++) {
+    for (uint8_t i = 0; i < _count; i++) {
+      Slot &slot = _slots[(_next + i) % _count];
+      if (slot.port->handleInterrupt()) {
+        record(slot, due, micros());
+        served++;
+      }
+    }
+
+    if (digitalRead(_irqPin) == HIGH)
+      break;
+  }
+
+  _next = (_next + 1) % _count;
+  return served;
+}
+
+uint8_t SC16IS7X0_Manager::serviceRoundRobin(uint8_t budget, bool dueOnly) {
+  uint32_t now = micros();
+  uint8_t served = 0;
+  for (uint8_t i = 0; i < _count && served < budget; i++) {
+    Slot &slot = _slots[(_next + i) % _count];
+    uint32_t due = deadline(slot);
+    if (dueOnly && (int32_t)(due - now) > 0)
+      continue;
+    servePolled(slot, due);
+    served++;
+  }
+
+  _next = (_next + (dueOnly ? 1 : budget)) % _count;
+  return served;
+}
+
+uint8_t SC16IS7X0_Manager::serviceEarliestDeadline(uint8_t budget) {
+  uint8_t served = 0;
+  // A port whose software RX buffer is full stays due, serve it once
+  bool done[SC16IS7X0_MANAGER_MAX_PORTS] = {};
+
+  while (served < budget) {
+    uint32_t now = micros();
+    Slot *latest = nullptr;
+    uint8_t latestIndex = 0;
+    int32_t latestDelay = 0;
+
+    for (uint8_t i = 0; i < _count; i++) {
+      uint8_t index = (_next + i) % _count;
+      if (done[index])
+        continue;
+      int32_t delay = (int32_t)(deadline(_slots[index]) - now);
+      if (delay <= 0 && (latest == nullptr || delay < latestDelay)) {
+        latest = &_slots[index];
+        latestIndex = index;
+        latestDelay = delay;
+      }
+    }
+
+    if (latest == nullptr)
+      break;
+
+    done[latestIndex] = true;
+    servePolled(*latest, now + latestDelay);
+    served++;
+  }
+
+  // Ties go to the next port on the following call
+  _next = (_next + 1) % _count;
+  return served;
+}
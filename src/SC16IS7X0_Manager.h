@@ -0,0 +1,81 @@
+#ifndef SC16IS7X0_MANAGER_H
+#define SC16IS7X0_MANAGER_H
+
+#include <Arduino.h>
+
+#include "SC16IS7X0.h"
+
+// Maximum number of devices handled by one SC16IS7X0_Manager
+#ifndef SC16IS7X0_MANAGER_MAX_PORTS
+#define SC16IS7X0_MANAGER_MAX_PORTS 16
+#endif
+
+/**
+ * @brief Services several SC16IS7X0 sharing a bus (and optionally an IRQ line)
+ * @details Each port has a service deadline, SC16IS7X0::nextServiceDeadline():
+ * the time its RX FIFO needs to fill up from the level seen by the previous
+ * service (or its TX FIFO to run dry). service() visits the ports either in turn
+ * (ROUND_ROBIN) or ordered by deadline, skipping the ports that are not due
+ * yet (EARLIEST_DEADLINE), so a fast port cannot starve the slow ones.
+ *
+ * With a shared IRQ line (open-drain outputs wired-OR), the IIR of every port
+ * is scanned while the line is asserted. The ports whose own deadline has
+ * passed are served as well: frame gaps, transfers on asynchronous buses and
+ * missed edges do not assert the line.
+ */
+class SC16IS7X0_Manager
+{
+public:
+  enum Policy : uint8_t { ROUND_ROBIN, EARLIEST_DEADLINE };
+
+  struct PortStats {
+    uint32_t services;      // Number of times the port has been served
+    uint32_t lastLatencyUs; // Service completion - deadline (or IRQ edge)
+    uint32_t maxLatencyUs;
+    uint32_t maxIntervalUs; // Longest time between two services
+  };
+
+  SC16IS7X0_Manager(Policy policy = EARLIEST_DEADLINE);
+
+  bool add(SC16IS7X0 *port);
+  uint8_t count(void) const { return _count; }
+  SC16IS7X0 *port(uint8_t index) const;
+
+  void setPolicy(Policy policy) { _policy = policy; }
+  Policy getPolicy(void) const { return _policy; }
+
+  bool enableInterrupt(uint8_t irqPin);
+  void disableInterrupt(void);
+
+  uint8_t service(uint8_t budget = 0);
+  uint32_t nextServiceDeadline(void) const;
+
+  const PortStats &stats(uint8_t index) const;
+  void resetStats(void);
+
+private:
+  struct Slot {
+    SC16IS7X0 *port;
+    uint32_t lastService;
+    PortStats stats;
+  };
+
+  static void IRAM_ATTR irqHandler(void *arg);
+
+  uint32_t deadline(const Slot &slot) const;
+  void servePolled(Slot &slot, uint32_t due);
+  void record(Slot &slot, uint32_t due, uint32_t end);
+  uint8_t serviceInterrupt(void);
+  uint8_t serviceRoundRobin(uint8_t budget, bool dueOnly);
+  uint8_t serviceEarliestDeadline(uint8_t budget);
+
+  Slot _slots[SC16IS7X0_MANAGER_MAX_PORTS];
+  uint8_t _count;
+  uint8_t _next;
+  Policy _policy;
+  int8_t _irqPin;
+  volatile bool _irqPending;
+  volatile uint32_t _irqStamp;
+};
+
+#endif // SC16IS7X0_MANAGER_H
@@ -0,0 +1,137 @@
+#ifndef SC16IS7X0_MPSCRINGBUFFER_H
+#define SC16IS7X0_MPSCRINGBUFFER_H
+
+#include <Arduino.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Called by a producer waiting for an earlier producer to publish its data.
+// The earlier one may have been preempted by a task of higher priority on the
+// same core, the waiting one must then block to let it run.
+#ifndef SC16IS7X0_RING_RELAX
+#ifdef ESP32
+#define SC16IS7X0_RING_RELAX() vTaskDelay(1)
+#else
+#define SC16IS7X0_RING_RELAX() yield()
+#endif
+#endif
+
+/**
+ * @brief Fixed size byte FIFO with several producers and one consumer
+ * @details Producers reserve room with a compare-and-swap on the reserve
+ * counter, copy their data, then publish it in reservation order by moving the
+ * head. A push() of up to N bytes is stored whole or not at all, so writes
+ * from different tasks are never interleaved. The consumer side has the same
+ * interface as SC16IS7X0_RingBuffer.
+ *
+ * @tparam N Capacity in bytes (power of two)
+ */
+template <size_t N> class SC16IS7X0_MpscRingBuffer {
+  static_assert(N > 0 && (N & (N - 1)) == 0,
+                "SC16IS7X0_MpscRingBuffer size must be a power of two");
+
+public:
+  SC16IS7X0_MpscRingBuffer() : _reserve(0), _head(0), _tail(0) {}
+
+  size_t capacity(void) const { return N; }
+  size_t size(void) const { return head() - tail(); }
+  bool empty(void) const { return size() == 0; }
+  bool full(void) const { return free() == 0; }
+
+  /**
+   * @brief Room left for the producers, reservations in progress included
+   */
+  size_t free(void) const {
+    return N - (__atomic_load_n(&_reserve, __ATOMIC_RELAXED) - tail());
+  }
+
+  /**
+   * @brief Drop everything published (consumer side)
+   */
+  void clear(void) { setTail(head()); }
+
+  bool push(uint8_t c) { return push(&c, 1) == 1; }
+
+  /**
+   * @brief Append len bytes, may be called from several tasks
+   * @details Nothing is stored if there is not enough room, unless len is
+   * larger than the capacity: the first part is then stored when the buffer
+   * has room for it.
+   *
+   * @return size_t Number of bytes stored
+   */
+  size_t push(const uint8_t *buffer, size_t len) {
+    size_t start = __atomic_load_n(&_reserve, __ATOMIC_RELAXED);
+    size_t n;
+    do {
+      size_t room = N - (start - tail());
+      n = len < N ? len : N;
+      if (n == 0 || n > room)
+        return 0;
+    } while (!__atomic_compare_exchange_n(&_reserve, &start, start + n, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    for (size_t i = 0; i < n; i++)
+      _buf[(start + i) & (N - 1)] = buffer[i];
+
+    // Publish after the producers that reserved before
+    for (uint32_t spins = 0;
+         __atomic_load_n(&_head, __ATOMIC_ACQUIRE) != start; spins++) {
+      if (spins >= 64)
+        SC16IS7X0_RING_RELAX();
+    }
+    __atomic_store_n(&_head, start + n, __ATOMIC_RELEASE);
+    return n;
+  }
+
+  int pop(void) {
+    size_t t = _tail;
+    if (t == head())
+      return -1;
+    uint8_t c = _buf[t & (N - 1)];
+    setTail(t + 1);
+    return c;
+  }
+
+  size_t pop(uint8_t *buffer, size_t len) {
+    len = peek(buffer, len);
+    setTail(_tail + len);
+    return len;
+  }
+
+  int peek(void) const {
+    size_t t = _tail;
+    if (t == head())
+      return -1;
+    return _buf[t & (N - 1)];
+  }
+
+  size_t peek(uint8_t *buffer, size_t len) const {
+    size_t t = _tail;
+    size_t count = head() - t;
+    if (len > count)
+      len = count;
+    for (size_t i = 0; i < len; i++)
+      buffer[i] = _buf[(t + i) & (N - 1)];
+    return len;
+  }
+
+  void skip(size_t len) {
+    size_t count = size();
+    if (len > count)
+      len = count;
+    setTail(_tail + len);
+  }
+
+private:
+  size_t head(void) const { return __atomic_load_n(&_head, __ATOMIC_ACQUIRE); }
+  size_t tail(void) const { return __atomic_load_n(&_tail, __ATOMIC_ACQUIRE); }
+  void setTail(size_t t) { __atomic_store_n(&_tail, t, __ATOMIC_RELEASE); }
+
+  uint8_t _buf[N];
+  size_t _reserve; // Written by the producers
+  size_t _head;    // Published by the producers, in reservation order
+  size_t _tail;    // Written by the consumer
+};
+
+#endif // SC16IS7X0_MPSCRINGBUFFER_H
@@ -0,0 +1,189 @@
+/**
+ * @file SC16IS7X0_Registers.cpp
+ * @brief Register shadow and write transaction builder
+ *
+ * @copyright MIT License
+ */
+
+#include "SC16IS7X0_Registers.h"
+
+#include <assert.h>
+
+#include "SC16IS7X0_defines.h"
+
+const uint8_t SC16IS7X0_Registers::_address[COUNT] = {
+    SC16IS7X0_IER,      SC16IS7X0_FCR,       SC16IS7X0_LCR,
+    SC16IS7X0_MCR,      SC16IS7X0_SPR,       SC16IS7X0_TCR,
+    SC16IS7X0_TLR,      SC16IS7X0_IODIR,     SC16IS7X0_IOSTATE,
+    SC16IS7X0_IOINTENA, SC16IS7X0_IOCONTROL, SC16IS7X0_EFCR,
+    SC16IS7X0_DLL,      SC16IS7X0_DLH,       SC16IS7X0_EFR,
+    SC16IS7X0_XON1,     SC16IS7X0_XON2,      SC16IS7X0_XOFF1,
+    SC16IS7X0_XOFF2};
+
+const SC16IS7X0_Registers::Bank SC16IS7X0_Registers::_bank[COUNT] = {
+    GENERAL,  GENERAL,  ANY,      GENERAL,  SCRATCH,  TCR_TLR, TCR_TLR,
+    ANY,      ANY,      ANY,      ANY,      ANY,      SPECIAL, SPECIAL,
+    ENHANCED, ENHANCED, ENHANCED, ENHANCED, ENHANCED};
+
+SC16IS7X0_Registers::SC16IS7X0_Registers() { reset(); }
+
+/**
+ * @brief Load the power-on values and forget what has been written
+ * @details Until a register has been written once, set() always sends it.
+ */
+void SC16IS7X0_Registers::reset(void) {
+  for (uint8_t i = 0; i < COUNT; i++)
+    _val[i] = 0x00;
+  _val[LCR] = 0x1D;
+  _val[SPR] = 0xFF;
+
+  _known = 0;
+  _chipLcr = _val[LCR];
+  _chipMcr = _val[MCR];
+  _last = COUNT;
+  _count = 0;
+  _sent = 0;
+}
+
+/**
+ * @brief Queue a register write
+ *
+ * @param reg Register
+ * @param val New value
+ * @param force Queue the write even if the shadow already holds val
+ */
+void SC16IS7X0_Registers::set(Reg reg, uint8_t val, bool force) {
+  // FCR[2:1] reset the FIFOs and clear themselves
+  if (reg == FCR && (val & 0x06))
+    force = true;
+
+  uint32_t bit = 1UL << reg;
+  if (!force && (_known & bit) && _val[reg] == val)
+    return;
+
+  selectBank(_bank[reg]);
+  emit(_address[reg] << 3, val, reg);
+
+  _val[reg] = (reg == FCR) ? (val & ~0x06) : val;
+  _known |= bit;
+
+  if (reg == LCR)
+    _chipLcr = val;
+  else if (reg == MCR)
+    _chipMcr = val;
+}
+
+/**
+ * @brief Update the shadow after the register has been written outside of
+ * commit(), e.g. by a burst
+ *
+ * @param reg Register, without pending write
+ * @param val Value now in the chip
+ */
+void SC16IS7X0_Registers::record(Reg reg, uint8_t val) {
+  _val[reg] = val;
+  _known |= 1UL << reg;
+}
+
+/**
+ * @brief Queue a write setting or clearing some bits of a register
+ *
+ * @param reg Register
+ * @param mask Bits to change
+ * @param state true to set the bits, false to clear them
+ */
+void SC16IS7X0_Registers::update(Reg reg, uint8_t mask, bool state) {
+  uint8_t val = state ? (_val[reg] | mask) : (_val[reg] & ~mask);
+  set(reg, val);
+}
+
+/**
+ * @brief Go back to the general register set and send the queued writes
+ *
+ * @param busIo Bus to the device
+ * @return true if the transaction succeeded or nothing had to be sent
+ */
+bool SC16IS7X0_Registers::commit(SC16IS7X0_BusIo *busIo) {
+  if (_chipMcr != _val[MCR]) {
+    selectBank(GENERAL);
+    emit(SC16IS7X0_MCR << 3, _val[MCR], COUNT);
+    _chipMcr = _val[MCR];
+  }
+  selectLcr(_val[LCR]);
+
+  _sent = 0;
+  if (_count == 0)
+    return true;
+
+  bool ok = busIo != nullptr && busIo->write_registers(_writes, _count);
+  _sent = busIo != nullptr ? _count : 0;
+  _count = 0;
+  _last = COUNT;
+
+  // The device state is unknown after a failure
+  if (!ok)
+    _known = 0;
+  return ok;
+}
+
+void SC16IS7X0_Registers::selectBank(Bank bank) {
+  switch (bank) {
+  case ANY:
+    break;
+
+  case GENERAL:
+    if (_chipLcr & 0x80)
+      selectLcr(_val[LCR] & ~0x80);
+    break;
+
+  case SPECIAL:
+    if (!(_chipLcr & 0x80))
+      selectLcr(_val[LCR] | 0x80);
+    break;
+
+  case ENHANCED:
+    selectLcr(0xBF);
+    break;
+
+  case TCR_TLR:
+    if (!(_val[EFR] & 0x10))
+      set(EFR, _val[EFR] | 0x10);
+    selectBank(GENERAL);
+    selectMcr(_chipMcr | 0x04);
+    break;
+
+  case SCRATCH:
+    selectBank(GENERAL);
+    if (_val[EFR] & 0x10)
+      selectMcr(_chipMcr & ~0x04);
+    break;
+  }
+}
+
+void SC16IS7X0_Registers::selectLcr(uint8_t lcr) {
+  if (_chipLcr == lcr)
+    return;
+  emit(SC16IS7X0_LCR << 3, lcr, COUNT);
+  _chipLcr = lcr;
+}
+
+void SC16IS7X0_Registers::selectMcr(uint8_t mcr) {
+  if (_chipMcr == mcr)
+    return;
+  emit(SC16IS7X0_MCR << 3, mcr, COUNT);
+  _chipMcr = mcr;
+}
+
+void SC16IS7X0_Registers::emit(uint8_t subaddress, uint8_t val, Reg reg) {
+  // Consecutive writes to the same register: only the last one matters
+  if (reg != COUNT && reg == _last && reg != FCR) {
+    _writes[2 * _count - 1] = val;
+    return;
+  }
+
+  assert(_count < MAX_WRITES);
+  _writes[2 * _count] = subaddress;
+  _writes[2 * _count + 1] = val;
+  _count++;
+  _last = reg;
+}
@@ -0,0 +1,99 @@
+#ifndef SC16IS7X0_REGISTERS_H
+#define SC16IS7X0_REGISTERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "SC16IS7X0_BusIo.h"
+
+/**
+ * @brief Shadow of the writable registers and builder of register write
+ * transactions
+ * @details Every writable register of the general, special (LCR[7] = 1),
+ * enhanced (LCR = 0xBF) and TCR/TLR (MCR[2] = 1 and EFR[4] = 1) sets is
+ * shadowed. set() queues a write only if the value differs from the shadow
+ * (or the register has never been written), and inserts the LCR / MCR writes
+ * needed to reach the register bank. commit() restores LCR and MCR and sends
+ * the whole sequence back-to-back with SC16IS7X0_BusIo::write_registers().
+ */
+class SC16IS7X0_Registers {
+public:
+  enum Reg : uint8_t {
+    IER,
+    FCR,
+    LCR,
+    MCR,
+    SPR,
+    TCR,
+    TLR,
+    IODIR,
+    IOSTATE,
+    IOINTENA,
+    IOCONTROL,
+    EFCR,
+    DLL,
+    DLH,
+    EFR,
+    XON1,
+    XON2,
+    XOFF1,
+    XOFF2,
+    COUNT
+  };
+
+  SC16IS7X0_Registers();
+
+  void reset(void);
+
+  /**
+   * @brief Shadowed value of a register
+   */
+  uint8_t get(Reg reg) const { return _val[reg]; }
+
+  void set(Reg reg, uint8_t val, bool force = false);
+  void update(Reg reg, uint8_t mask, bool state);
+  void record(Reg reg, uint8_t val);
+  bool commit(SC16IS7X0_BusIo *busIo);
+
+  /**
+   * @brief Number of register writes waiting for commit()
+   */
+  size_t pending(void) const { return _count; }
+
+  /**
+   * @brief Number of register writes sent by the last commit()
+   */
+  size_t sent(void) const { return _sent; }
+
+private:
+  enum Bank : uint8_t {
+    ANY,      // Accessible whatever the LCR value
+    GENERAL,  // LCR[7] = 0
+    SPECIAL,  // LCR[7] = 1
+    ENHANCED, // LCR = 0xBF
+    TCR_TLR,  // LCR[7] = 0, MCR[2] = 1 and EFR[4] = 1
+    SCRATCH   // LCR[7] = 0, MCR[2] = 0 or EFR[4] = 0
+  };
+
+  // LCR and MCR writes inserted to switch banks can at most double a batch
+  static constexpr size_t MAX_WRITES = 2 * COUNT + 4;
+
+  void selectBank(Bank bank);
+  void selectLcr(uint8_t lcr);
+  void selectMcr(uint8_t mcr);
+  void emit(uint8_t subaddress, uint8_t val, Reg reg);
+
+  static const uint8_t _address[COUNT];
+  static const Bank _bank[COUNT];
+
+  uint8_t _val[COUNT];
+  uint32_t _known;
+  uint8_t _chipLcr;
+  uint8_t _chipMcr;
+  Reg _last;
+  uint8_t _writes[2 * MAX_WRITES];
+  size_t _count;
+  size_t _sent;
+};
+
+#endif // SC16IS7X0_REGISTERS_H
@@ -0,0 +1,136 @@
+#ifndef SC16IS7X0_RINGBUFFER_H
+#define SC16IS7X0_RINGBUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Fixed size byte FIFO used to buffer RX and TX data in RAM
+ * @details Head and tail are free running counters, the capacity must be a
+ * power of two. One producer and one consumer may use the buffer without
+ * locking, from different tasks or cores: each side only moves its own index
+ * and publishes it with release semantics after touching the data.
+ *
+ * @tparam N Capacity in bytes (power of two)
+ */
+template <size_t N> class SC16IS7X0_RingBuffer {
+  static_assert(N > 0 && (N & (N - 1)) == 0,
+                "SC16IS7X0_RingBuffer size must be a power of two");
+
+public:
+  SC16IS7X0_RingBuffer() : _head(0), _tail(0) {}
+
+  size_t capacity(void) const { return N; }
+  size_t size(void) const { return head() - tail(); }
+  size_t free(void) const { return N - size(); }
+  bool empty(void) const { return size() == 0; }
+  bool full(void) const { return size() == N; }
+
+  void clear(void) { setTail(head()); }
+
+  /**
+   * @brief Append one byte
+   *
+   * @return true if the byte has been stored, false if the buffer is full
+   */
+  bool push(uint8_t c) {
+    size_t h = _head;
+    if (h - tail() == N)
+      return false;
+    _buf[h & (N - 1)] = c;
+    setHead(h + 1);
+    return true;
+  }
+
+  /**
+   * @brief Append up to len bytes
+   *
+   * @return size_t Number of bytes stored
+   */
+  size_t push(const uint8_t *buffer, size_t len) {
+    size_t h = _head;
+    size_t room = N - (h - tail());
+    if (len > room)
+      len = room;
+    for (size_t i = 0; i < len; i++)
+      _buf[(h + i) & (N - 1)] = buffer[i];
+    setHead(h + len);
+    return len;
+  }
+
+  /**
+   * @brief Remove and return the oldest byte
+   *
+   * @return int The byte or -1 if the buffer is empty
+   */
+  int pop(void) {
+    size_t t = _tail;
+    if (t == head())
+      return -1;
+    uint8_t c = _buf[t & (N - 1)];
+    setTail(t + 1);
+    return c;
+  }
+
+  /**
+   * @brief Remove up to len bytes
+   *
+   * @return size_t Number of bytes copied into buffer
+   */
+  size_t pop(uint8_t *buffer, size_t len) {
+    len = peek(buffer, len);
+    setTail(_tail + len);
+    return len;
+  }
+
+  /**
+   * @brief Return the oldest byte without removing it
+   *
+   * @return int The byte or -1 if the buffer is empty
+   */
+  int peek(void) const {
+    size_t t = _tail;
+    if (t == head())
+      return -1;
+    return _buf[t & (N - 1)];
+  }
+
+  /**
+   * @brief Copy up to len of the oldest bytes without removing them
+   *
+   * @return size_t Number of bytes copied into buffer
+   */
+  size_t peek(uint8_t *buffer, size_t len) const {
+    size_t t = _tail;
+    size_t count = head() - t;
+    if (len > count)
+      len = count;
+    for (size_t i = 0; i < len; i++)
+      buffer[i] = _buf[(t + i) & (N - 1)];
+    return len;
+  }
+
+  /**
+   * @brief Drop up to len of the oldest bytes
+   */
+  void skip(size_t len) {
+    size_t count = size();
+    if (len > count)
+      len = count;
+    setTail(_tail + len);
+  }
+
+private:
+  // The data written before an index is published is visible to the other
+  // side once it reads the index
+  size_t head(void) const { return __atomic_load_n(&_head, __ATOMIC_ACQUIRE); }
+  size_t tail(void) const { return __atomic_load_n(&_tail, __ATOMIC_ACQUIRE); }
+  void setHead(size_t h) { __atomic_store_n(&_head, h, __ATOMIC_RELEASE); }
+  void setTail(size_t t) { __atomic_store_n(&_tail, t, __ATOMIC_RELEASE); }
+
+  uint8_t _buf[N];
+  size_t _head;
+  size_t _tail;
+};
+
+#endif // SC16IS7X0_RINGBUFFER_H
@@ -70,6 +70,47 @@
 
 #define SC16IS7X0_READ_FLAG 0x80
 
+// Size of the RX and TX FIFO
+#define SC16IS7X0_FIFO_SIZE 64
+
+// Interrupt sources reported in IIR[5:0] (by priority)
+
+// No interrupt pending (IIR[0] = 1)
+#define SC16IS7X0_IIR_NONE 0x01
+// Receiver line status error
+#define SC16IS7X0_IIR_RLS 0x06
+// Receiver time-out
+#define SC16IS7X0_IIR_RX_TIMEOUT 0x0C
+// RHR interrupt (RX FIFO above trigger level)
+#define SC16IS7X0_IIR_RHR 0x04
+// THR interrupt (TX FIFO below trigger level)
+#define SC16IS7X0_IIR_THR 0x02
+// Modem status
+#define SC16IS7X0_IIR_MSR 0x00
+// Input pin change of state (Only available on the SC16IS750/SC16IS760)
+#define SC16IS7X0_IIR_IO 0x30
+// Received XOFF signal or special character
+#define SC16IS7X0_IIR_XOFF 0x10
+// CTS, RTS change of state from active (LOW) to inactive (HIGH)
+#define SC16IS7X0_IIR_CTS_RTS 0x20
+// Mask of the interrupt source bits
+#define SC16IS7X0_IIR_MASK 0x3E
+
+// Software flow control modes (EFR[3:0]), one TX mode ORed with one RX mode
+
+// Transmit XON1 / XOFF1 on the RX FIFO levels of TCR
+#define SC16IS7X0_SWFLOW_TX_XON1 0x08
+// Transmit XON2 / XOFF2
+#define SC16IS7X0_SWFLOW_TX_XON2 0x04
+// Transmit XON1 then XON2, XOFF1 then XOFF2
+#define SC16IS7X0_SWFLOW_TX_XON12 0x0C
+// Halt / resume the transmitter on a received XOFF1 / XON1
+#define SC16IS7X0_SWFLOW_RX_XON1 0x02
+// Halt / resume the transmitter on a received XOFF2 / XON2
+#define SC16IS7X0_SWFLOW_RX_XON2 0x01
+// Halt / resume the transmitter on XOFF1 and XOFF2 / XON1 and XON2
+#define SC16IS7X0_SWFLOW_RX_XON12 0x03
+
 //============================================
 // Some defines needed by the ESP32 platforms
 //============================================